@@ -15,26 +15,93 @@
 
 #pragma stacksize(512)
 
+#ifdef CARTRIDGE
+
+// EasyFlash cartridge build, code and data are copied from bank 0 into
+// RAM below the ROM window, variables and stack are not accessed while
+// the window is enabled.  Buffers filled from the ROM banks live in the
+// cartbss section below the window, so they never depend on writes
+// falling through the ROM to the RAM underneath
+#pragma section( cartbss, 0, , , bss)
+#pragma region( main, 0x0a00, 0x7e00, , , {code, data, cartbss} )
+#pragma region( stack, 0x7e00, 0x8000, , , {stack})
+#pragma region( mainbss, 0x8000, 0x9e00, , , {bss, heap} )
+
+// Compressed assets, music and sprites in ROM banks, copied on demand
+#pragma section( cartassets, 0 )
+#pragma region( cartassets, 0x8000, 0xa000, , 1, {cartassets} )
+
+#pragma section( cartmusic, 0 )
+#pragma region( cartmusic, 0x8000, 0xa000, , 2, {cartmusic} )
+
+#pragma section( cartsprites, 0 )
+#pragma region( cartsprites, 0x8000, 0xa000, , 3, {cartsprites} )
+
+// Tiles, attributes and the small charsets in ROM, copied into bss
+// under the ROM window on startup to keep the main region for code
+#pragma section( carttiles, 0 )
+#pragma region( carttiles, 0x8000, 0xa000, , 5, {carttiles} )
+
+// Flash programming code in ROM bank 4, compiled for and copied into
+// the cassette buffer, which stays visible in ultimax mode
+#pragma section( cartflash, 0 )
+#pragma region( cartflash, 0x8000, 0x80c8, , 4, {cartflash}, 0x0334 )
+
+#else
+
 // setup main memory region for code and data
 #pragma region( main, 0x0a00, 0x9e00, , , {code, data, bss, heap} )
 #pragma region( stack, 0x9e00, 0xa000, , , {stack})
 
+#endif
+
 // Extended bss section in unused system screen buffer
 #pragma section( xbss, 0, , , bss)
 #pragma region( xbss, 0x0400, 0x0800, , , {xbss})
 
-// Music data below the basic rom
+// Music data below the basic rom, sprite data
+#ifdef CARTRIDGE
+#pragma section( music, 0, , , bss)
+#pragma section( spriteset, 0, , , bss)
+#else
 #pragma section( music, 0)
-#pragma region( music, 0xa000, 0xc000, , , {music} )
-
-// Sprite data
 #pragma section( spriteset, 0)
+#endif
+
+#pragma region( music, 0xa000, 0xc000, , , {music} )
 #pragma region( spriteset, 0xc000, 0xd000, , , {spriteset} )
 
 // Math tables
 #pragma section( tables, 0, , , bss)
 #pragma region( tables, 0xf000, 0xff00, , , {tables})
 
+#ifdef CARTRIDGE
+
+// Music and sprites in ROM, copied into their sections on startup
+#pragma data(cartmusic)
+
+const char music_rom[] = {
+	#embed 0x2000 0x88 "GameScene.sid"
+};
+
+#pragma data(cartsprites)
+
+const char spriteset_rom[4095] = {
+	#embed 4095 0 "ballnchain - Sprites.bin"
+};
+
+#pragma bss(music)
+
+__export char music[0x2000];
+
+#pragma bss(spriteset)
+
+char spriteset[4095];
+
+#pragma bss(bss)
+
+#else
+
 // Load music into music section
 #pragma data(music)
 
@@ -49,13 +116,43 @@ char spriteset[4095] = {
 	#embed 4095 0 "ballnchain - Sprites.bin"
 };
 
-#pragma data(data)
+#endif
 
-// Compressed charset, tiles and attributes for center range
-char charset_center[] = {
-	#embed lzo "ballnchain_center - Chars.bin"
+#ifdef CARTRIDGE
+
+// Tiles, attributes and small charsets in one ROM image, in the order
+// of the offsets below
+#pragma data(carttiles)
+
+const char tiles_rom[] = {
+	#embed 1024 0 "ballnchain_center - Tiles.bin"
+	#embed 192 0 "ballnchain_center - CharAttribs_L1.bin"
+	#embed 512 0 "ballnchain_bottom - Tiles.bin"
+	#embed 512 0 "ballnchain_front - Chars.bin"
+	#embed 512 0 "ballnchain_digits - Chars.bin"
 };
 
+#define TILES_ROM_CENTER	0
+#define TILES_ROM_ATTRIBS	1024
+#define TILES_ROM_BOTTOM	1216
+#define TILES_ROM_FRONT		1728
+#define TILES_ROM_DIGITS	2240
+
+#pragma bss(bss)
+
+char tileset_center[1024];
+char charattribs_center[192];
+char tileset_bottom[512];
+char charset_front[512];
+char charset_digits[512];
+
+#pragma data(data)
+
+#else
+
+#pragma data(data)
+
+// Tiles and attributes for center range
 char tileset_center[] = {
 	#embed "ballnchain_center - Tiles.bin"	
 };
@@ -64,11 +161,7 @@ char charattribs_center[] = {
 	#embed "ballnchain_center - CharAttribs_L1.bin"	
 };
 
-// Compressed charset, attributes and tioles for bottom range
-char charset_bottom[] = {
-	#embed lzo "ballnchain_bottom - Chars.bin"
-};
-
+// Tiles for bottom range
 char tileset_bottom[] = {
 	#embed "ballnchain_bottom - Tiles.bin"	
 };
@@ -84,12 +177,53 @@ char charset_digits[] = {
 	#embed "ballnchain_digits - Chars.bin"
 };
 
-// Compressed multicolor hires screen
-char titlescreen[] = {
+#endif
+
+// Compressed charsets and multicolor hires screen, in a ROM bank for
+// cartridge builds, the compressed assets are created with
+//
+//   tools/lzfpack.py "ballnchain_center - Chars.lzf" "ballnchain_center - Chars.bin"
+//   tools/lzfpack.py "ballnchain_bottom - Chars.lzf" "ballnchain_bottom - Chars.bin"
+//   tools/lzfpack.py titlesketch.lzf titlesketch.bin:0:8000 titlesketch.bin:8000:1000 titlesketch.bin:9000:1000
+
+#ifdef CARTRIDGE
+#pragma data(cartassets)
+#endif
+
+const char charset_center[] = {
+	#embed "ballnchain_center - Chars.lzf"
+};
+
+const char charset_bottom[] = {
+	#embed "ballnchain_bottom - Chars.lzf"
+};
+
+const char titlescreen[] = {
+	#embed "titlesketch.lzf"
+};
+
+#pragma data(data)
+
+#if defined(EXPAND_PROFILE) && defined(CARTRIDGE)
+#error "EXPAND_PROFILE needs the assets in RAM"
+#endif
+
+#ifdef EXPAND_PROFILE
+// Same assets in the built in lzo format, for comparison
+char charset_center_lzo[] = {
+	#embed lzo "ballnchain_center - Chars.bin"
+};
+
+char charset_bottom_lzo[] = {
+	#embed lzo "ballnchain_bottom - Chars.bin"
+};
+
+char titlescreen_lzo[] = {
 	#embed 8000    0 lzo "titlesketch.bin"
 	#embed 1000 8000 lzo "titlesketch.bin"
 	#embed 1000 9000 lzo "titlesketch.bin"
 };
+#endif
 
 // Double buffered screend
 byte * const Screen0 = (byte *)0xc800;
@@ -116,6 +250,17 @@ byte	lsrtab4[256];	// Unsigned shift by four bits to the right
 byte	asltab4[256];	// Shift by four bits to the left
 byte	sqrtabl[256];	// Square table low byte
 byte	sqrtabh[256];	// Square table high byte
+byte	nrmtab[16][32];	// Quantized direction of vectors in the first octant
+byte	frictll[256];	// Friction of velocity high byte, result low byte
+byte	frictlh[256];	// Friction of velocity high byte, result high byte
+byte	frictp[256];	// Friction of velocity low byte for positive velocity
+byte	frictn[256];	// Friction of velocity low byte for negative velocity
+byte	bubbll[256];	// Bubble decay of velocity high byte, result low byte
+byte	bubblh[256];	// Bubble decay of velocity high byte, result high byte
+byte	bubblo[256];	// Bubble decay of velocity low byte
+
+// Collision tables, maintained at runtime
+byte	csolid[4][64];	// Packed solid bitmap of playfield columns, 8 rows per plane
 
 #pragma bss(bss)
 
@@ -125,21 +270,90 @@ byte	sqrtabh[256];	// Square table high byte
 #pragma align(asltab4, 256)
 #pragma align(sqrtabl, 256)
 #pragma align(sqrtabh, 256)
+#pragma align(nrmtab, 256)
+#pragma align(frictll, 256)
+#pragma align(frictlh, 256)
+#pragma align(frictp, 256)
+#pragma align(frictn, 256)
+#pragma align(bubbll, 256)
+#pragma align(bubblh, 256)
+#pragma align(bubblo, 256)
+#pragma align(csolid, 256)
+
+// Derived data built on game start, kept until overwritten, the title
+// screen image covers the fonts and the math tables
+enum InitData
+{
+	INIT_MATH	= 0x01,		// Math tables
+	INIT_FONT	= 0x02,		// Expanded game fonts
+	INIT_IRQS	= 0x04		// Game play interrupt code
+};
+
+char		init_valid;
 
 // Variables that depend on video standard
 bool		ntsc;
-char		music56, physics56;	// 5/6 reduction for music and physics in NTSC
 char		maxvx, minvx;	// max and min velocity per frame
 
+// Music tick scheduler, PAL ticks twice per frame, NTSC five times in three
+// frames to keep the PAL tempo.  The ticks sit on nearly evenly spaced raster
+// lines, the NTSC frame phase selects which of the five slots tick in this
+// frame.  The in game tune takes up to 722 cycles per tick with the third
+// voice patched out, 11 NTSC lines plus the interrupt entry.  The last slot
+// is moved up from line 232 to 224 so the tick ends well before the bottom
+// interrupt at line 250, spacing it eight lines off the even 158 line rhythm
+const char	music_pal_lines[2] = {70, 226};
+const char	music_ntsc_lines[6] = {22, 75, 127, 180, 224, 180};
+const char	music_ntsc_phase[5] = {0, 1, 2, 0, 1};
+
+char		music_phase, music_irq_slot, music_slot_line;
+
+// Fixed timestep physics, running at 50 steps per second.  The accumulator
+// gains physics_rate (6 in PAL, 5 in NTSC) per frame, and a step is taken
+// whenever six units are available.
+char		physics_acc, physics_rate, physics_frac;
+bool		physics_step;
+
 // Current frame index and pointer to current screen
 bool		cframe;
 byte	*	cscreen;
 
-// Score status
-char		score[9];
+// Score status, six digits of packed BCD with the most significant
+// pair first and the number of stars in BCD.  Changed digits are
+// flagged in score_dirty for a deferred redraw
+char		score[3];
+char		score_stars;
+char		score_dirty;
+char		score_delta;
 char		nstars;
 unsigned	scorecnt;
 
+// Stackless coroutines for work spread over several frames.  A step
+// function resumes at the yield point it left in the previous call with
+// a switch on its resume state, and returns true while it has more to
+// do.  The resume state is the source line of the yield point, so there
+// must be at most one yield point per line.  Yields and loops are single
+// statements and may be nested in other statements, but not in a switch
+// of their own.  Local variables do not survive a yield, state goes into
+// globals.
+//
+//	CO_BEGIN(co)			start of the body
+//	CO_YIELD(co);			continue here in the next call
+//	CO_WHILE(co, c)			run the loop body once per call while c holds,
+//							break leaves the loop
+//	CO_LOOP(co);			end of the loop body
+//	CO_RESTART(co);			start over in the next call
+//	CO_END(co)				end of the body, next call starts over
+
+typedef unsigned Coroutine;
+
+#define CO_BEGIN(co)		switch (co) { case 0:
+#define CO_YIELD(co)		do { co = __LINE__; return true; case __LINE__:; } while (0)
+#define CO_WHILE(co, c)		do { case __LINE__: if (!(c)) break; co = __LINE__;
+#define CO_LOOP(co)			return true; } while (0)
+#define CO_RESTART(co)		do { co = 0; return true; } while (0)
+#define CO_END(co)			} co = 0; return false;
+
 #pragma bss(xbss)
 
 // Raster based interrupt descriptors
@@ -170,18 +384,25 @@ char		 scr_row[40];
 // Zero page variable for scrolling screen
 __zeropage char	ctop, cbottom ,csize, bimg, bcnt, cimg, ccnt, cdist, cimgy;
 
+// Zero page ring index of the next column in the solid bitmap
+__zeropage char	cgen;
+
 // Title screen animation variables
 const char * 	title_tp;
 char			title_sy, title_ky, title_ty, title_by[8];
-char			title_delay;
+char			title_delay, title_page;
 int				title_bx, title_cy;
 
+// Resume state of the current title animation step and of the title
+// image expansion
+Coroutine		title_co, title_expand_co;
+
 // Title screen sprite animation data
 sbyte	title_vx[7];
 int		title_px[7];
 
 RIRQCode20		irq_top20, irq_bottom20;
-RIRQCode		irq_center, irq_music;
+RIRQCode		irq_center, irq_music[5];
 
 RIRQCode	* const	irq_top = &irq_top20.c;
 RIRQCode	* const	irq_bottom = &irq_bottom20.c;
@@ -203,22 +424,31 @@ static char mineflash[16] = {
 	VCOL_RED, VCOL_RED, VCOL_RED, VCOL_RED	
 };
 
-// Current highscore status
+// Size of the highscore table and entries per display page
+#define HIGHSCORES		100
+#define HIGHSCORE_PAGE	5
+
+// Current highscore status, sorted by score, six digits of packed BCD
+// with the most significant pair first, unused entries have a zero score
 struct Highscore
 {
 	char	name[3];
-	char	score[6];
-
-}	highscores[5] = {
-	{"ABC", "000500"},
-	{"DEF", "000400"},
-	{"GHI", "000300"},
-	{"JKL", "000200"},
-	{"MNO", "000100"},
+	char	score[3];
+
+}	highscores[HIGHSCORES] = {
+	{"ABC", {0x00, 0x05, 0x00}},
+	{"DEF", {0x00, 0x04, 0x00}},
+	{"GHI", {0x00, 0x03, 0x00}},
+	{"JKL", {0x00, 0x02, 0x00}},
+	{"MNO", {0x00, 0x01, 0x00}},
 };
 
 char	highscoreName[] = "AAA";
 
+// Page of the highscore table shown after the top page on the title
+// screen, advances with each showing
+char	highscorePage;
+
 // Scrolling title text
 const char title_text[] = 
 //   012345678901
@@ -326,9 +556,80 @@ struct Credits
 	},
 };
 
+// Voices the music does not play on the SID, the third one when it is
+// patched out of the replay routine, the second one while it is lent
+bool			music_mute[3];
+
+// Voice registers written while a voice is muted, so the music can
+// resume it with its current sound, and whether the second voice is
+// lent to sound effects
+char			music_shadow[21];
+bool			music_shared;
+
+// Operand addresses of the voice register stores in the replay routine,
+// and their registers, in the order the routine writes them
+const unsigned	music_voice_ops[7] = {0xa2e7, 0xa2ed, 0xa2f3, 0xa2f9, 0xa2ff, 0xa305, 0xa30e};
+const char		music_voice_regs[7] = {5, 6, 2, 3, 0, 1, 4};
+
+// Copy the shadow registers of the voice at register offset v to the SID,
+// in the order of the replay routine.  Always called with a constant
+// voice, so each register is an absolute load and store of eight cycles,
+// the two voices forwarded in each tick while the second one is lent
+// take 112 cycles
+inline void music_shadow_voice(char v)
+{
+	char	*	dp = (char *)0xd400 + v;
+	const char	*	sp = music_shadow + v;
+
+	dp[5] = sp[5];
+	dp[6] = sp[6];
+	dp[2] = sp[2];
+	dp[3] = sp[3];
+	dp[0] = sp[0];
+	dp[1] = sp[1];
+	dp[4] = sp[4];
+}
+
+// Lend the second voice to sound effects or take it back.  While lent,
+// the voice stores of the replay routine point to the shadow registers,
+// the sequence keeps running unheard and music_tick forwards the other
+// voices.  Taking it back resumes the voice with its current registers
+
+void music_share_voice2(bool share)
+{
+	if (share != music_shared)
+	{
+		char	*	dp = share ? music_shadow : (char *)0xd400;
+
+		// The operands must not change while an interrupt runs the player
+		__asm
+		{
+			php
+			sei
+		}
+
+		for(char i=0; i<7; i++)
+			*(char **)music_voice_ops[i] = dp + music_voice_regs[i];
+
+		music_mute[1] = share;
+		music_shared = share;
+		if (!share)
+			music_shadow_voice(7);
+
+		__asm
+		{
+			plp
+		}
+	}
+}
+
 // Initialize a sub tune in the music code
 void music_init(char tune)
 {
+	music_share_voice2(false);
+	music_phase = 0;
+	music_slot_line = 255;
+
 	__asm
 	{
 		lda		tune
@@ -336,21 +637,101 @@ void music_init(char tune)
 	}
 }
 
+#ifdef MUSIC_PROFILE
+// Max number of raster lines spent in one call of the music player
+char		music_lines;
+#endif
+
 // Play next track element in the music code
-void music_play(void)
+void music_tick(void)
 {
-	// Decimate to 5/6 for ntsc
-	if (ntsc && music56 == 5)
+#ifdef MUSIC_PROFILE
+	// Show duration of the call in the border and keep the maximum
+	char	r = vic.raster;
+	vic.color_border = VCOL_WHITE;
+#endif
+	__asm
+	{
+		jsr		$a003
+	}
+
+	// All voices went to the shadow while the second one is lent,
+	// forward the ones the music still plays
+	if (music_shared)
 	{
-		music56 = 0;
+		music_shadow_voice(0);
+		if (!music_mute[2])
+			music_shadow_voice(14);
 	}
+#ifdef MUSIC_PROFILE
+	vic.color_border = VCOL_BLACK;
+	r = vic.raster - r;
+	if (r > music_lines)
+		music_lines = r;
+#endif
+}
+
+// Advance the NTSC frame phase after the last slot of the frame
+inline void music_next_phase(void)
+{
+	if (music_phase == 2)
+		music_phase = 0;
+	else
+		music_phase++;
+}
+
+// Music interrupt, music_irq_slot is written by the raster code before
+// the call, PAL ticks in every slot, NTSC only in the slots of its phase
+__interrupt void music_irq(void)
+{
+	char	s = music_irq_slot;
+	if (!ntsc)
+		music_tick();
 	else
 	{
-		music56++;
-		__asm
-		{
-			jsr		$a003
-		}
+		if (music_ntsc_phase[s] == music_phase)
+			music_tick();
+		if (s == 4)
+			music_next_phase();
+	}
+}
+
+// Play music from the main thread on screens without music interrupts,
+// slot 0 in the upper and slot 1 in the lower half of the frame, waiting
+// for the raster line of the tick
+void music_slot(char slot)
+{
+	char	line;
+	bool	tick = true;
+	if (ntsc)
+	{
+		// Third NTSC phase has a single tick, its second slot only
+		// keeps the frame rhythm
+		char	i = music_phase + 3 * slot;
+		line = music_ntsc_lines[i];
+		tick = i < 5;
+	}
+	else
+		line = music_pal_lines[slot];
+
+	// Wait for the raster to wrap past the previous frame's last slot
+	if (slot == 0)
+	{
+		while (vic.raster >= music_slot_line)
+			;
+	}
+
+	while (vic.raster < line)
+		;
+
+	if (tick)
+		music_tick();
+
+	if (slot)
+	{
+		music_slot_line = line;
+		if (ntsc)
+			music_next_phase();
 	}
 }
 
@@ -360,10 +741,618 @@ void music_patch_volume(char vol)
 	*(char *)0xa103 = vol;	
 }
 
+// SID voices available for sound effects, one bit per voice
+char	sfx_voices;
+
+// Pending sound effect requests
+#define SFX_REQUESTS	4
+
+// Frames a request waits for a voice before it is dropped
+#define SFX_WAIT		8
+
+// Effects of this priority and above may borrow the second music voice,
+// it returns to the music when the effect completes
+#define SFX_BORROW_PRIORITY	5
+
+const SIDFX	*	sfx_req_fx[SFX_REQUESTS];
+char			sfx_req_cnt[SFX_REQUESTS], sfx_req_age[SFX_REQUESTS];
+
+// Effect and its priority playing on each voice, zero if idle
+const SIDFX	*	sfx_fx[3];
+char			sfx_prio[3];
+
 // Enable or disable the 3rd SID voice in the music code
 void music_patch_voice3(bool enable)
 {
 	*(char *)0xa10c = enable ? 0x20 : 0x4c;
+	music_mute[2] = !enable;
+
+	// Third voice is free for sound effects without music, the second
+	// one is only lent for the duration of an effect
+	music_share_voice2(false);
+	sfx_voices = enable ? 0x00 : 0x04;
+	for(char i=0; i<SFX_REQUESTS; i++)
+		sfx_req_cnt[i] = 0;
+}
+
+// Reset sound effects and voice allocation
+void sfx_init(void)
+{
+	sidfx_init();
+
+	for(char v=0; v<3; v++)
+		sfx_prio[v] = 0;
+	for(char i=0; i<SFX_REQUESTS; i++)
+		sfx_req_cnt[i] = 0;
+}
+
+// Request a sound effect, the voice is assigned in sfx_loop
+void sfx_play(const SIDFX * fx, char cnt)
+{
+	// Use the request of the same effect, so repeated triggers never
+	// queue it twice
+	char	j = 0xff;
+	for(char i=0; i<SFX_REQUESTS; i++)
+	{
+		if (sfx_req_cnt[i] && sfx_req_fx[i] == fx)
+		{
+			j = i;
+			break;
+		}
+	}
+
+	// Otherwise a free request, or replace the lowest priority one
+	if (j == 0xff)
+	{
+		j = 0;
+		for(char i=0; i<SFX_REQUESTS; i++)
+		{
+			if (!sfx_req_cnt[i])
+			{
+				j = i;
+				break;
+			}
+			else if (sfx_req_fx[i]->priority < sfx_req_fx[j]->priority)
+				j = i;
+		}
+	}
+
+	if (!sfx_req_cnt[j] || sfx_req_fx[j] == fx || sfx_req_fx[j]->priority <= fx->priority)
+	{
+		sfx_req_fx[j] = fx;
+		sfx_req_cnt[j] = cnt;
+		sfx_req_age[j] = 0;
+	}
+}
+
+// Assign pending requests to voices and advance sound effects, called
+// once per frame
+void sfx_loop(void)
+{
+	// Release voices that completed their effect
+	for(char v=0; v<3; v++)
+	{
+		if (sidfx_idle(v))
+			sfx_prio[v] = 0;
+	}
+	if (music_shared && !sfx_prio[1])
+		music_share_voice2(false);
+
+	// Place requests by priority, at most one per voice
+	for(char k=0; k<3; k++)
+	{
+		// Highest priority pending request
+		char	r = 0xff, rp = 0;
+		for(char i=0; i<SFX_REQUESTS; i++)
+		{
+			if (sfx_req_cnt[i] && (r == 0xff || sfx_req_fx[i]->priority > rp))
+			{
+				r = i;
+				rp = sfx_req_fx[i]->priority;
+			}
+		}
+
+		if (r == 0xff)
+			break;
+
+		// The voice already playing this effect restarts it, else a
+		// free voice or the voice with the lowest priority effect.  High
+		// priority effects may also borrow the second music voice, the
+		// voices of the effects are checked first
+		char	voices = sfx_voices;
+		if (rp >= SFX_BORROW_PRIORITY)
+			voices |= 0x02;
+
+		char	v = 0xff, vp = 0;
+		for(char n=0; n<3; n++)
+		{
+			char	i = 2 - n;
+			if (voices & (1 << i))
+			{
+				if (sfx_prio[i] && sfx_fx[i] == sfx_req_fx[r])
+				{
+					v = i;
+					vp = 0;
+					break;
+				}
+				else if (v == 0xff || sfx_prio[i] < vp)
+				{
+					v = i;
+					vp = sfx_prio[i];
+				}
+			}
+		}
+
+		// Steal only from an effect of the same or lower priority
+		if (v == 0xff || rp < vp)
+			break;
+
+		if (v == 1)
+			music_share_voice2(true);
+		sidfx_play(v, sfx_req_fx[r], sfx_req_cnt[r]);
+		sfx_fx[v] = sfx_req_fx[r];
+		sfx_prio[v] = rp;
+		sfx_req_cnt[r] = 0;
+	}
+
+	// Drop requests that waited too long for a voice
+	for(char i=0; i<SFX_REQUESTS; i++)
+	{
+		if (sfx_req_cnt[i] && ++sfx_req_age[i] == SFX_WAIT)
+			sfx_req_cnt[i] = 0;
+	}
+
+	sidfx_loop_2();
+}
+
+// Zero page state of the lzf decoder
+__zeropage const char	*	lzf_sp;
+__zeropage char			*	lzf_dp, * lzf_mp, * lzf_end;
+__zeropage char				lzf_n;
+__zeropage bool				lzf_more;
+
+// Start expanding an lzf stream created by tools/lzfpack.py in chunks
+
+inline void expand_lzf_start(char * dp, const char * sp)
+{
+	lzf_dp = dp;
+	lzf_sp = sp;
+}
+
+// Expand the next chunk of the current lzf stream, stops after at least
+// n bytes (up to 16K) are written.  Returns false at the end of the stream,
+// with lzf_sp behind the end marker
+
+bool expand_lzf_chunk(unsigned n)
+{
+	lzf_end = lzf_dp + n;
+
+	__asm
+	{
+	loop:
+		ldy		#0
+		lda		(lzf_sp), y
+		bne		token
+		jmp		done
+	token:
+		bmi		match
+
+		// Literal run of 1 to 127 bytes
+
+		sta		lzf_n
+		inc		lzf_sp
+		bne		lcopy
+		inc		lzf_sp + 1
+	lcopy:
+		lda		(lzf_sp), y
+		sta		(lzf_dp), y
+		iny
+		cpy		lzf_n
+		bne		lcopy
+
+		tya
+		clc
+		adc		lzf_sp
+		sta		lzf_sp
+		bcc		lnext
+		inc		lzf_sp + 1
+		clc
+	lnext:
+		tya
+		adc		lzf_dp
+		sta		lzf_dp
+		bcc		next
+		inc		lzf_dp + 1
+
+	next:
+		// Continue until the end of the chunk is reached
+
+		lda		lzf_dp
+		cmp		lzf_end
+		lda		lzf_dp + 1
+		sbc		lzf_end + 1
+		bmi		loop
+		lda		#1
+		jmp		exit
+
+	match:
+		cmp		#$c0
+		bcs		mlong
+
+		// Short match of 2 to 65 bytes, distance 1 to 256
+
+		and		#$3f
+		adc		#2
+		sta		lzf_n
+		iny
+		lda		(lzf_sp), y
+		eor		#$ff
+		clc
+		adc		lzf_dp
+		sta		lzf_mp
+		lda		lzf_dp + 1
+		adc		#$ff
+		sta		lzf_mp + 1
+		lda		#2
+		bne		mskip
+
+	mlong:
+		// Long match of 3 to 66 bytes, negative 16 bit distance
+
+		and		#$3f
+		adc		#2
+		sta		lzf_n
+		iny
+		lda		(lzf_sp), y
+		clc
+		adc		lzf_dp
+		sta		lzf_mp
+		iny
+		lda		(lzf_sp), y
+		adc		lzf_dp + 1
+		sta		lzf_mp + 1
+		lda		#3
+
+	mskip:
+		clc
+		adc		lzf_sp
+		sta		lzf_sp
+		bcc		mcopy0
+		inc		lzf_sp + 1
+	mcopy0:
+		ldy		#0
+	mcopy:
+		lda		(lzf_mp), y
+		sta		(lzf_dp), y
+		iny
+		cpy		lzf_n
+		bne		mcopy
+
+		tya
+		clc
+		adc		lzf_dp
+		sta		lzf_dp
+		bcc		mnext
+		inc		lzf_dp + 1
+	mnext:
+		jmp		next
+
+	done:
+		// Skip end marker
+
+		lda		lzf_sp
+		clc
+		adc		#1
+		sta		lzf_sp
+		lda		lzf_sp + 1
+		adc		#0
+		sta		lzf_sp + 1
+		lda		#0
+	exit:
+		sta		lzf_more
+	}
+
+	return lzf_more;
+}
+
+// Expand a complete lzf stream, returns the source pointer behind the
+// end marker
+
+const char * expand_lzf(char * dp, const char * sp)
+{
+	expand_lzf_start(dp, sp);
+	while (expand_lzf_chunk(0x4000))
+		;
+
+	return lzf_sp;
+}
+
+#ifdef CARTRIDGE
+
+// EasyFlash bank and control registers
+#define cart_bank	(*(volatile char *)0xde00)
+#define cart_ctrl	(*(volatile char *)0xde02)
+
+#define CART_CTRL_OFF	0x04	// Cartridge ROM disabled
+#define CART_CTRL_8K	0x06	// ROML bank visible at 0x8000
+#define CART_CTRL_ULTIMAX	0x05	// ROML visible and writeable, RAM only up to 0x1000
+
+// Flash programming code in the cassette buffer
+#define FLASH_CODE		0x0334
+#define FLASH_CODE_SIZE	0xc8
+
+// Bounce buffer for compressed data from ROM, a chunk of up to 256
+// bytes reads less than 400 bytes of stream
+#define CART_BOUNCE		512
+
+#pragma bss(cartbss)
+
+char			cart_bounce[CART_BOUNCE];
+
+#pragma bss(bss)
+
+// Source position of the current lzf stream in the asset bank
+const char	*	cart_sp;
+
+// Copy from a ROM bank into RAM outside of the ROM window, with the
+// raster interrupt masked, because the IRQ vector is in the kernal ROM
+// while the window is enabled
+void cart_copy(char bank, char * dp, const char * sp, unsigned size)
+{
+	char	ie = vic.intr_enable;
+	vic.intr_enable = 0;
+
+	mmap_set(MMAP_ROM);
+	cart_bank = bank;
+	cart_ctrl = CART_CTRL_8K;
+
+	memcpy(dp, sp, size);
+
+	cart_ctrl = CART_CTRL_OFF;
+	mmap_set(MMAP_NO_ROM);
+
+	vic.intr_enable = ie;
+}
+
+// Copy from a ROM bank into RAM under the ROM window, through the bounce
+// buffer, so the window is never enabled over the target
+
+void cart_load(char bank, char * dp, const char * sp, unsigned size)
+{
+	while (size > 0)
+	{
+		unsigned	n = size < CART_BOUNCE ? size : CART_BOUNCE;
+		cart_copy(bank, cart_bounce, sp, n);
+		memcpy(dp, cart_bounce, n);
+		dp += n;
+		sp += n;
+		size -= n;
+	}
+}
+
+// Start expanding a compressed asset
+
+inline void asset_expand_start(char * dp, const char * sp)
+{
+	lzf_dp = dp;
+	cart_sp = sp;
+}
+
+// Expand the next chunk of up to 256 bytes of a compressed asset through
+// the bounce buffer, the decoder itself never sees the ROM window
+
+bool asset_expand_chunk(unsigned n)
+{
+	cart_copy(1, cart_bounce, cart_sp, CART_BOUNCE);
+	lzf_sp = cart_bounce;
+
+	bool	more = expand_lzf_chunk(n);
+	cart_sp += lzf_sp - cart_bounce;
+
+	return more;
+}
+
+#else
+
+// Start expanding a compressed asset
+
+inline void asset_expand_start(char * dp, const char * sp)
+{
+	expand_lzf_start(dp, sp);
+}
+
+// Expand the next chunk of up to 256 bytes of a compressed asset
+
+inline bool asset_expand_chunk(unsigned n)
+{
+	return expand_lzf_chunk(n);
+}
+
+#endif
+
+// Continue with the next stream behind the end of the current one
+
+inline void asset_expand_next(char * dp)
+{
+	lzf_dp = dp;
+}
+
+// Expand a complete compressed asset
+
+void asset_expand(char * dp, const char * sp)
+{
+	asset_expand_start(dp, sp);
+	while (asset_expand_chunk(256))
+		;
+}
+
+#ifdef EXPAND_PROFILE
+// Compressed size and decode cycles of the charsets and the three title
+// screen parts, in lzo and lzf format, to be read with a monitor
+unsigned		expand_size[5][2];
+unsigned long	expand_cycles[5][2];
+
+// Start the CIA 2 timers, timer B counting the underflows of timer A
+void expand_timer_start(void)
+{
+	cia2.cra = 0x00;
+	cia2.crb = 0x00;
+	cia2.ta = 0xffff;
+	cia2.tb = 0xffff;
+	cia2.crb = 0x51;
+	cia2.cra = 0x11;
+}
+
+// Stop the CIA 2 timers and return the elapsed cycles
+unsigned long expand_timer_stop(void)
+{
+	cia2.cra = 0x00;
+	cia2.crb = 0x00;
+	return 0xffffffffUL - (((unsigned long)cia2.tb << 16) | cia2.ta);
+}
+
+// Decode all assets with both decoders, the targets are overwritten
+// later during startup
+void expand_profile(void)
+{
+	const char * sp, * tp;
+
+	expand_timer_start();
+	sp = oscar_expand_lzo(Font, charset_center_lzo);
+	expand_cycles[0][0] = expand_timer_stop();
+	expand_size[0][0] = sp - charset_center_lzo;
+
+	expand_timer_start();
+	sp = expand_lzf(Font, charset_center);
+	expand_cycles[0][1] = expand_timer_stop();
+	expand_size[0][1] = sp - charset_center;
+
+	expand_timer_start();
+	sp = oscar_expand_lzo(FontBottom, charset_bottom_lzo);
+	expand_cycles[1][0] = expand_timer_stop();
+	expand_size[1][0] = sp - charset_bottom_lzo;
+
+	expand_timer_start();
+	sp = expand_lzf(FontBottom, charset_bottom);
+	expand_cycles[1][1] = expand_timer_stop();
+	expand_size[1][1] = sp - charset_bottom;
+
+	sp = titlescreen_lzo;
+	tp = titlescreen;
+	for(char i=0; i<3; i++)
+	{
+		char	*	dp = i == 0 ? Font : i == 1 ? Screen1 : Color;
+		const char * p;
+
+		expand_timer_start();
+		p = oscar_expand_lzo(dp, sp);
+		expand_cycles[2 + i][0] = expand_timer_stop();
+		expand_size[2 + i][0] = p - sp;
+		sp = p;
+
+		expand_timer_start();
+		p = expand_lzf(dp, tp);
+		expand_cycles[2 + i][1] = expand_timer_stop();
+		expand_size[2 + i][1] = p - tp;
+		tp = p;
+	}
+}
+#endif
+
+// Frame scheduler, deferrable work is queued as jobs and run in slices
+// while the main thread waits for the raster IRQ to signal the next
+// frame phase.  A job is a function doing one slice of work, returning
+// true while there is more to do.  Each slot has the raster lines a
+// slice may take, so a slice only starts if it ends before the wait
+
+typedef bool (* FrameJobStep)(void);
+
+// Job slots, in order of priority
+enum FrameJob
+{
+	FJ_COLUMN,		// Build and copy the next playfield column
+	FJ_COPY,		// Scroll the lower half of the back buffer
+	FJ_SCORE,		// Redraw changed score digits
+	FJ_EXPAND,		// Expand compressed assets
+	FJ_HSSAVE,		// Save the highscore table
+
+	NUM_FRAME_JOBS
+};
+
+FrameJobStep	frame_job_step[NUM_FRAME_JOBS];
+char			frame_job_lines[NUM_FRAME_JOBS];
+
+// Bit mask of queued jobs, by slot
+char			frame_jobs;
+
+static const char frame_job_bit[NUM_FRAME_JOBS] = {0x01, 0x02, 0x04, 0x08, 0x10};
+
+// Frames predicted to overrun by the frame budget governor are lean,
+// they scroll only half of the back buffer and queue the other half
+bool			frame_lean;
+
+// Queue a job, or replace the job in its slot
+
+void frame_job_queue(FrameJob job, FrameJobStep step, char lines)
+{
+	frame_job_step[job] = step;
+	frame_job_lines[job] = lines;
+	frame_jobs |= frame_job_bit[job];
+}
+
+inline bool frame_job_queued(FrameJob job)
+{
+	return (frame_jobs & frame_job_bit[job]) != 0;
+}
+
+inline void frame_job_cancel(FrameJob job)
+{
+	frame_jobs &= ~frame_job_bit[job];
+}
+
+// Complete a job now, if it is still queued
+
+void frame_job_finish(FrameJob job)
+{
+	while (frame_job_queued(job))
+	{
+		if (!frame_job_step[job]())
+			frame_job_cancel(job);
+	}
+}
+
+// Run one slice of the most important job that fits into the given
+// number of raster lines, returns false if there was none
+
+bool frame_work(char lines)
+{
+	for(char i=0; i<NUM_FRAME_JOBS; i++)
+	{
+		if ((frame_jobs & frame_job_bit[i]) && frame_job_lines[i] <= lines)
+		{
+			if (!frame_job_step[i]())
+				frame_jobs &= ~frame_job_bit[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Raster lines in the vertical border, for work done after waiting
+// for the bottom of the screen
+#define FRAME_BORDER_LINES	48
+
+// Raster lines left until line 248, where the game loop does its
+// vertical blank work, zero if already past it
+
+char frame_lines_left(void)
+{
+	if (vic.ctrl1 & VIC_CTRL1_RST8)
+		return 0;
+
+	char	y = vic.raster - 40;
+	return y < 208 ? 208 - y : 0;
 }
 
 // Zero page random seed
@@ -570,11 +1559,53 @@ void titlescreen_spaces(char y)
 		titlescreen_char(i, y, ' ');
 }
 
-//  Draw zero terminated string into a row of title screen sprites
-void titlescreen_string(char x, char y, const char * p)
+//  Draw zero terminated string into a row of title screen sprites
+void titlescreen_string(char x, char y, const char * p)
+{
+	while (*p)
+		titlescreen_char(x++, y, *p++);
+}
+
+// Put a number without leading zeros into the title sprites, returns
+// the column behind it
+
+char titlescreen_number(char x, char y, char n)
+{
+	if (n >= 100)
+	{
+		titlescreen_char(x++, y, '0' + n / 100);
+		n %= 100;
+		titlescreen_char(x++, y, '0' + n / 10);
+	}
+	else if (n >= 10)
+		titlescreen_char(x++, y, '0' + n / 10);
+
+	titlescreen_char(x++, y, '0' + n % 10);
+
+	return x;
+}
+
+// Put highscore table entry i into row y of the title sprites, unused
+// entries show without a name
+
+void titlescreen_highscore_entry(char y, char i)
 {
-	while (*p)
-		titlescreen_char(x++, y, *p++);
+	const Highscore	*	hp = highscores + i;
+	bool	used = hp->score[0] | hp->score[1] | hp->score[2];
+
+	for(char j=0; j<3; j++)
+	{
+		titlescreen_char(j     , y, used ? hp->name[j] : '-');
+		titlescreen_char(j  + 3, y, '.');
+	}
+
+	// Two digits per BCD byte
+	for(char j=0; j<3; j++)
+	{
+		char	d = hp->score[j];
+		titlescreen_char(2 * j + 6, y, '0' + (d >> 4));
+		titlescreen_char(2 * j + 7, y, '0' + (d & 0x0f));
+	}
 }
 
 // Initialize the title screen scroll animation
@@ -737,6 +1768,24 @@ void titlescreen_scroll_clear(void)
 	title_delay = 0;	
 }
 
+// Start moving in a page of the highscore table, the entries are drawn
+// while the lines move in
+
+void titlescreen_highscore_page(char page)
+{
+	for(char i=0; i<6; i++)
+	{
+		// Position per line and velocity
+
+		title_px[i] = 4 * (- 24 - 48 * (i + 3));
+		title_vx[i] = 64;
+	}
+
+	title_page = page;
+	title_delay = 0;
+	title_ty = 0;
+}
+
 // Init title screen for highscore display
 
 void titlescreen_highscore_init(void)
@@ -781,11 +1830,6 @@ void titlescreen_highscore_init(void)
 		irq_title_x[1][i] = 254;
 		irq_title_x[2][i] = 254;
 		irq_title_x[3][i] = 254;
-
-		// Position per line and velocity
-
-		title_px[i] = 4 * (- 24 - 48 * (i + 3));
-		title_vx[i] = 64;
 	}
 
 	// sort the raster IRQs
@@ -797,8 +1841,40 @@ void titlescreen_highscore_init(void)
 
 	vic.spr_enable = 0xff;
 
-	title_delay = 0;
-	title_ty = 0;
+	titlescreen_highscore_page(0);
+}
+
+// Show the next page of the highscore table after the top page, pages
+// without entries are skipped, returns false if there is none
+
+bool titlescreen_highscore_next(void)
+{
+	if (title_page)
+		return false;
+
+	for(char i=1; i<HIGHSCORES / HIGHSCORE_PAGE; i++)
+	{
+		highscorePage++;
+		if (highscorePage == HIGHSCORES / HIGHSCORE_PAGE)
+			highscorePage = 1;
+
+		const Highscore	*	hp = highscores + highscorePage * HIGHSCORE_PAGE;
+		if (hp->score[0] | hp->score[1] | hp->score[2])
+		{
+			// Rank range as title, overwriting the previous one
+			titlescreen_string(0, 0, "RANK ");
+			char	x = titlescreen_number(5, 0, highscorePage * HIGHSCORE_PAGE + 1);
+			titlescreen_char(x++, 0, '-');
+			x = titlescreen_number(x, 0, highscorePage * HIGHSCORE_PAGE + HIGHSCORE_PAGE);
+			while (x < 12)
+				titlescreen_char(x++, 0, ' ');
+
+			titlescreen_highscore_page(highscorePage);
+			return true;
+		}
+	}
+
+	return false;
 }
 
 // Animate one frame of title screen for highscore display
@@ -814,13 +1890,7 @@ bool titlescreen_highscore_step(void)
 	{
 		char i = title_delay - 1;
 
-		for(char j=0; j<3; j++)
-		{
-			titlescreen_char(j     , 2 * i + 2, highscores[i].name[j]);
-			titlescreen_char(j  + 3, 2 * i + 2, '.');
-		}
-		for(char j=0; j<6; j++)
-			titlescreen_char(j +  6, 2 * i + 2, highscores[i].score[j]);		
+		titlescreen_highscore_entry(2 * i + 2, title_page * HIGHSCORE_PAGE + i);
 	}
 
 	// Update x position of highscore lines
@@ -955,133 +2025,120 @@ void titlescreen_credits_init(void)
 	title_tp = credits_text;
 }
 
-// Animate one frame of title screen for credits display
+// Move the current credits block, returns false once it has left the
+// screen
 
-bool titlescreen_credits_step(void)
+bool titlescreen_credits_move(void)
 {
-	// Check current display phase
+	sbyte	dx = credits[title_ty].dx, dy = credits[title_ty].dy;
 
-	switch (title_ty)
-	{
-	case 0:
-	case 2:
-	case 4:
-	case 6:
-	case 8:
-		// Even phase, preparation
+	title_bx += dx;
+	title_cy += dy;
 
-		// Prepare one line
-		if (title_sy & 1)
-		{
-			for(char j=0; j<12; j++)
-				titlescreen_char(j, title_sy >> 1, title_tp[j]);
-			title_tp += 12;
-		}
+	return !(dx < 0 && title_bx < -408 || dx > 0 && title_bx >= 688 ||
+			 dy < 0 && title_cy < -20 || dy > 0 && title_cy >= 490);
+}
 
-		title_sy ++;
-		if (title_sy == 8)
-		{
-			// All lines done, now for the display
+// Place the sprites of the current credits block
 
-			title_ty++;
-			title_sy = 0;			
+void titlescreen_credits_place(void)
+{
+	// For both lines
+
+	for(char i=0; i<2; i++)
+	{
+		int			x = title_bx >> 1;
+		char		msb = 0;
 
-			// Setup start position and color
+		// Update x position
 
-			char	k = title_ty >> 1;
-			title_bx = 2 * credits[k].px;
-			title_cy = 2 * credits[k].py;
+		for(char j=0; j<4; j++)
+		{
+			// Special cases for x expanded sprites to the left
 
-			vic.spr_color[0] = 
-			vic.spr_color[1] = 
-			vic.spr_color[2] = 
-			vic.spr_color[3] = credits[k].color;
+			if (x < -24 || x > 344)
+			{
+				irq_title_x[j][i] = 200;
+				msb |= 0x11 << j;				
+			}
+			else if (!ntsc && x < 0)
+			{
+				irq_title_x[j][i] = x - 8;
+				msb |= 0x11 << j;
+			}
+			else if (x == 255)
+			{
+				irq_title_x[j][i] = 255;
+				msb |= 0x01 << j;
+			}
+			else
+			{
+				irq_title_x[j][i] = x;
+				if (x & 0x100)
+					msb |= 0x11 << j;
+			}
+			x += 48;
 		}
+		irq_title_msbx[i] = msb;
 
-		vic_waitTop();
-		break;
-	case 1:
-	case 3:
-	case 5:
-	case 7:
-	case 9:
-	{
-		// Odd phase, animation
+		// Update y position
+
+		unsigned	ty =  (title_cy >> 1) + 25 * i;
+		if (ty > 23 && ty < 245)
+			rirq_set(i, ty, irq_title + i);
+		else
+			rirq_clear(i);
+
+		irq_title_y[i] = ty + 6;
+	}
 
-		char	k = title_ty >> 1;
-		sbyte	dx = credits[k].dx, dy = credits[k].dy;
+	rirq_sort();
+}
 
-		// Move sprite block
+// Animate one frame of title screen for credits display, the blocks
+// of text in title_ty are prepared and then moved across the screen
 
-		title_bx += dx;
-		title_cy += dy;
+bool titlescreen_credits_step(void)
+{
+	CO_BEGIN(title_co)
 
-		// Check if block is at least partially visible
+	// Prepare one line every other frame
 
-		if (dx < 0 && title_bx < -408 || dx > 0 && title_bx >= 688 ||
-			dy < 0 && title_cy < -20 || dy > 0 && title_cy >= 490)
+	CO_WHILE(title_co, title_sy < 8)
+		if (title_sy & 1)
 		{
-			// If not just advance clock
-
-			title_ty++;
+			for(char j=0; j<12; j++)
+				titlescreen_char(j, title_sy >> 1, title_tp[j]);
+			title_tp += 12;
 		}
-		else
-		{
-			// For both lines
-
-			for(char i=0; i<2; i++)
-			{
-				int			x = title_bx >> 1;
-				char		msb = 0;
+		title_sy++;
+		vic_waitTop();
+	CO_LOOP(title_co);
 
-				// Update x position
+	// All lines done, setup start position and color
 
-				for(char j=0; j<4; j++)
-				{
-					// Special cases for x expanded sprites to the left
+	title_sy = 0;
+	title_bx = 2 * credits[title_ty].px;
+	title_cy = 2 * credits[title_ty].py;
 
-					if (x < -24 || x > 344)
-					{
-						irq_title_x[j][i] = 200;
-						msb |= 0x11 << j;				
-					}
-					else if (!ntsc && x < 0)
-					{
-						irq_title_x[j][i] = x - 8;
-						msb |= 0x11 << j;
-					}
-					else if (x == 255)
-					{
-						irq_title_x[j][i] = 255;
-						msb |= 0x01 << j;
-					}
-					else
-					{
-						irq_title_x[j][i] = x;
-						if (x & 0x100)
-							msb |= 0x11 << j;
-					}
-					x += 48;
-				}
-				irq_title_msbx[i] = msb;
+	vic.spr_color[0] = 
+	vic.spr_color[1] = 
+	vic.spr_color[2] = 
+	vic.spr_color[3] = credits[title_ty].color;
 
-				// Update y position
+	// Move the block until it has left the screen
 
-				unsigned	ty =  (title_cy >> 1) + 25 * i;
-				if (ty > 23 && ty < 245)
-					rirq_set(i, ty, irq_title + i);
-				else
-					rirq_clear(i);
+	CO_WHILE(title_co, titlescreen_credits_move())
+		titlescreen_credits_place();
+	CO_LOOP(title_co);
 
-				irq_title_y[i] = ty + 6;
-			}
-		}
-	}	break;
-	}
+	// Next block
 
-	rirq_sort();
+	title_ty++;
+	if (title_ty < 5)
+		CO_RESTART(title_co);
 
-	return title_ty < 10;
+	CO_END(title_co)
 }
 
 // Clean up after credits display
@@ -1419,14 +2476,46 @@ enum TitleScreenAnim
 
 bool titlescreen_clear_step(void)
 {
-	if (title_delay < 12)
-	{
+	CO_BEGIN(title_co)
+
+	CO_WHILE(title_co, title_delay < 12)
 		memset(DynSprites + 256 * title_delay, 0, 256);
 		title_delay++;
-		return true;
-	}
-	else
-		return false;
+	CO_LOOP(title_co);
+
+	CO_END(title_co)
+}
+
+// Bytes of the title screen image expanded per music call, well below
+// half a frame with the display disabled, at most 256 for the bounce
+// buffer of cartridge builds
+#define TITLE_CHUNK		256
+
+// Raster lines available for expansion in each half of the frame
+#define TITLE_LINES		120
+
+// Expand the next chunk of the title screen image, bitmap, screen and
+// color parts in sequence, returns false when complete
+bool titlescreen_expand_step(void)
+{
+	CO_BEGIN(title_expand_co)
+
+	CO_WHILE(title_expand_co, asset_expand_chunk(TITLE_CHUNK))
+	CO_LOOP(title_expand_co);
+
+	asset_expand_next(Screen1);
+	CO_YIELD(title_expand_co);
+
+	CO_WHILE(title_expand_co, asset_expand_chunk(TITLE_CHUNK))
+	CO_LOOP(title_expand_co);
+
+	asset_expand_next(Color);
+	CO_YIELD(title_expand_co);
+
+	CO_WHILE(title_expand_co, asset_expand_chunk(TITLE_CHUNK))
+	CO_LOOP(title_expand_co);
+
+	CO_END(title_expand_co)
 }
 
 // Show and animate the title screen
@@ -1436,12 +2525,21 @@ void titlescreen_show(void)
 	music_patch_voice3(true);
 	music_init(1);
 
-	// Expand hires image
-	const char * sp = titlescreen;
+	// Expand hires image behind the blanked screen as a frame job, one
+	// chunk after each music call
+	title_expand_co = 0;
+	asset_expand_start(Font, titlescreen);
+	init_valid &= ~(INIT_MATH | INIT_FONT);
+	frame_job_queue(FJ_EXPAND, titlescreen_expand_step, TITLE_LINES);
+
+	while (frame_job_queued(FJ_EXPAND))
+	{
+		music_slot(0);
+		frame_work(TITLE_LINES);
 
-	sp = oscar_expand_lzo(Font, sp);
-	sp = oscar_expand_lzo(Screen1, sp);
-	sp = oscar_expand_lzo(Color, sp);
+		music_slot(1);
+		frame_work(TITLE_LINES);
+	}
 
 	// Hide sprites
 	vic.spr_enable = 0x00;
@@ -1455,6 +2553,7 @@ void titlescreen_show(void)
 	memset(DynSprites, 0x00, 48 * 64);
 
 	title_delay = 0;
+	title_co = 0;
 	TitleScreenAnim	anim = TSA_INTRO_TEXT_0;
 
 	// anim = TSA_CREDITS_0;
@@ -1528,7 +2627,7 @@ void titlescreen_show(void)
 			rirq_wait();
 			vic_waitBottom();
 
-			if (!titlescreen_highscore_step())
+			if (!titlescreen_highscore_step() && !titlescreen_highscore_next())
 			{
 				titlescreen_highscore_clear();
 				titlescreen_balls_init();
@@ -1565,18 +2664,11 @@ void titlescreen_show(void)
 
 		}
 
-		// Wait for top of screen
-		vic_waitTop();
-
-		// Play some music
-		music_play();
+		// Play some music in the upper half of the screen
+		music_slot(0);
 
-		// Wait for center screen
-		while (vic.raster < 150)
-			;
-
-		// Play more music
-		music_play();
+		// Play more music in the lower half
+		music_slot(1);
 
 		// Check joystick button
 		joy_poll(0);
@@ -1658,63 +2750,350 @@ void titlescreen_show(void)
 	}	
 }
 
-// Move some random columns down for game end animation
+// Move some random columns down for game end animation
+
+void column_down(void)
+{
+	// Number of columns depends on display mode, lower
+	// number in NTSC due to higher frame rate
+
+	for(char i=ntsc ? 3 : 5; i>0; i--)
+	{
+		// Draw one random column from deck
+		char j = (frand() >> 8) & 15;
+
+		// Get actual column index
+		char x = scr_row[j];
+
+		// Remove column from deck
+		while (j < 39)
+		{
+			scr_row[j] = scr_row[j + 1];
+			j++;
+		}
+
+		// Put it at the end of the deck
+		scr_row[39] = x;
+
+		// Scroll column down, complete unroll
+	#assign yi 23
+	#repeat
+		Screen1[yi * 40 + 40 + x] = Screen1[yi * 40 + x];
+		Color[yi * 40 + 40 + x] = Color[yi * 40 + x];
+	#assign yi yi - 1
+	#until yi < 0
+	#undef yi
+
+		// Fill new char at top with black
+		Screen1[x] = 0xc1;
+	}
+}
+
+// Compare packed BCD score with highscore table entry, return true if
+// greater
+
+bool highscore_greater(const char * s, char n)
+{
+	// Loop over three digit pairs, BCD compares like binary
+	for(char k=0; k<3; k++)
+	{
+		// Compare digits with highscore entry
+		if (s[k] > highscores[n].score[k])
+			return true;
+		else if (s[k] < highscores[n].score[k])
+			return false;
+	}
+
+	// All the same
+	return false;
+}
+
+// Rank of a packed BCD score in the sorted highscore table with a
+// binary search, behind entries with the same score, HIGHSCORES if
+// the score does not make it into the table
+
+char highscore_rank(const char * s)
+{
+	char	lo = 0, hi = HIGHSCORES;
+	while (lo < hi)
+	{
+		char	mid = (lo + hi) >> 1;
+		if (highscore_greater(s, mid))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+#ifdef CARTRIDGE
+
+// Highscore tables are saved as records in the first bank of the second
+// flash sector, the first sector holds the game.  A record is a magic
+// byte, the table and a checksum byte, the newest valid record wins.
+// Records are appended until the bank is full, then the sector is
+// erased and saving starts over with the first slot
+
+#define HS_BANK		8
+#define HS_MAGIC	0xa6	// Changes with the record layout
+#define HS_RECORD	(sizeof(highscores) + 2)
+#define HS_SLOT		1024
+#define HS_SLOTS	(0x2000 / HS_SLOT)
+
+// Bytes written to flash per frame, each takes about 50 cycles with
+// the raster interrupt masked
+#define HS_SLICE	8
+
+// Raster lines for one slice
+#define HS_LINES	8
+
+enum HighscoreSave
+{
+	HSS_IDLE,
+	HSS_ERASE,
+	HSS_WRITE
+};
+
+HighscoreSave	hs_state;
+char			hs_slot, hs_sum;
+unsigned		hs_pos;
+
+// Flash target address and staging buffer, visible in ultimax mode
+__zeropage char	*	flash_dp;
+__zeropage char		flash_n;
+__zeropage char		flash_buf[HS_SLICE];
+
+#pragma code(cartflash)
+
+// Program flash_n bytes from flash_buf to flash_dp in the current bank,
+// or erase the sector of the current bank if flash_n is zero.  Flash
+// writes need ultimax mode, so this runs from the cassette buffer
+
+__noinline void flash_command(void)
+{
+	__asm
+	{
+		lda		#CART_CTRL_ULTIMAX
+		sta		$de02
+		ldy		#0
+		lda		flash_n
+		beq		erase
+
+	prog:
+		lda		#$aa
+		sta		$8555
+		lda		#$55
+		sta		$82aa
+		lda		#$a0
+		sta		$8555
+		lda		flash_buf, y
+		sta		(flash_dp), y
+
+		// Toggle bit changes with each read while busy
+
+	busy:
+		lda		(flash_dp), y
+		cmp		(flash_dp), y
+		bne		busy
+		iny
+		cpy		flash_n
+		bne		prog
+		beq		exit
+
+	erase:
+		lda		#$aa
+		sta		$8555
+		lda		#$55
+		sta		$82aa
+		lda		#$80
+		sta		$8555
+		lda		#$aa
+		sta		$8555
+		lda		#$55
+		sta		$82aa
+		lda		#$30
+		sta		(flash_dp), y
+
+	exit:
+		lda		#CART_CTRL_OFF
+		sta		$de02
+	}
+}
+
+#pragma code(code)
+
+// Run a flash command with the raster interrupt masked, the IRQ vector
+// is in cartridge ROM while in ultimax mode
+
+void flash_run(void)
+{
+	char	ie = vic.intr_enable;
+	vic.intr_enable = 0;
+
+	cart_bank = HS_BANK;
+	flash_command();
+
+	vic.intr_enable = ie;
+}
+
+// Check for an erase in progress
+
+bool flash_busy(void)
+{
+	char	s[2];
+	cart_copy(HS_BANK, s, (char *)0x8000, 2);
+	return ((s[0] ^ s[1]) & 0x40) != 0;
+}
+
+// Byte of the highscore record at position i
+
+char highscore_byte(unsigned i)
+{
+	if (i == 0)
+		return HS_MAGIC;
+	else if (i == HS_RECORD - 1)
+		return hs_sum;
+	else
+		return ((char *)highscores)[i - 1];
+}
+
+// Check the record in a slot, the sum of all its bytes is zero, read
+// through the bounce buffer in pieces
+
+bool highscore_check(char slot)
+{
+	const char	*	sp = (char *)0x8000 + slot * HS_SLOT;
+	char			sum = 0;
+
+	for(unsigned i=0; i<HS_RECORD; i+=CART_BOUNCE)
+	{
+		unsigned	n = HS_RECORD - i < CART_BOUNCE ? HS_RECORD - i : CART_BOUNCE;
+		cart_copy(HS_BANK, cart_bounce, sp + i, n);
+		if (i == 0 && cart_bounce[0] != HS_MAGIC)
+			return false;
+
+		for(unsigned j=0; j<n; j++)
+			sum += cart_bounce[j];
+	}
+
+	return sum == 0;
+}
+
+// Load the newest valid highscore table from flash, keeps the built in
+// table if there is none
 
-void column_down(void)
+void highscore_load(void)
 {
-	// Number of columns depends on display mode, lower
-	// number in NTSC due to higher frame rate
+	// Next free slot behind the last written one
+	hs_slot = HS_SLOTS;
+	while (hs_slot > 0)
+	{
+		char	c;
+		cart_copy(HS_BANK, &c, (char *)0x8000 + (hs_slot - 1) * HS_SLOT, 1);
+		if (c != 0xff)
+			break;
+		hs_slot--;
+	}
 
-	for(char i=ntsc ? 3 : 5; i>0; i--)
+	// Newest record with a valid checksum
+	char	i = hs_slot;
+	while (i > 0)
 	{
-		// Draw one random column from deck
-		char j = (frand() >> 8) & 15;
+		i--;
+		if (highscore_check(i))
+		{
+			cart_copy(HS_BANK, (char *)highscores, (char *)0x8000 + i * HS_SLOT + 1, sizeof(highscores));
+			break;
+		}
+	}
 
-		// Get actual column index
-		char x = scr_row[j];
+	hs_state = HSS_IDLE;
+}
 
-		// Remove column from deck
-		while (j < 39)
+// Continue saving the highscore table with a short slice of work, once
+// per frame, returns true while the save is in progress
+
+bool highscore_save_step(void)
+{
+	switch (hs_state)
+	{
+	case HSS_ERASE:
+		// Sector erase takes about a second
+		if (!flash_busy())
 		{
-			scr_row[j] = scr_row[j + 1];
-			j++;
+			hs_slot = 0;
+			hs_state = HSS_WRITE;
 		}
+		return true;
 
-		// Put it at the end of the deck
-		scr_row[39] = x;
+	case HSS_WRITE:
+		// Stage the next few bytes and program them
+		flash_dp = (char *)0x8000 + hs_slot * HS_SLOT + hs_pos;
+		flash_n = 0;
+		while (flash_n < HS_SLICE && hs_pos < HS_RECORD)
+			flash_buf[flash_n++] = highscore_byte(hs_pos++);
+		flash_run();
 
-		// Scroll column down, complete unroll
-	#assign yi 23
-	#repeat
-		Screen1[yi * 40 + 40 + x] = Screen1[yi * 40 + x];
-		Color[yi * 40 + 40 + x] = Color[yi * 40 + x];
-	#assign yi yi - 1
-	#until yi < 0
-	#undef yi
+		if (hs_pos < HS_RECORD)
+			return true;
 
-		// Fill new char at top with black
-		Screen1[x] = 0xc1;
+		hs_slot++;
+		hs_state = HSS_IDLE;
+		return false;
 	}
+
+	return false;
 }
 
-// Compare current score with highscore table entry, return true if greater
+// Start saving the highscore table, the record is written by a frame
+// job in later frames
 
-bool highscore_greater(char n)
+void highscore_save(void)
 {
-	// Loop over six digits
-	for(char k=0; k<6; k++)
+	// A partly written record is left behind, it fails its checksum
+	if (hs_state == HSS_WRITE)
+		hs_slot++;
+
+	char	sum = HS_MAGIC;
+	for(unsigned i=0; i<sizeof(highscores); i++)
+		sum += ((char *)highscores)[i];
+	hs_sum = -sum;
+	hs_pos = 0;
+
+	if (hs_state == HSS_ERASE)
+		;
+	else if (hs_slot >= HS_SLOTS)
 	{
-		// Compare digit with highscore entry
-		if (score[k] > highscores[n].score[k])
-			return true;
-		else if (score[k] < highscores[n].score[k])
-			return false;
+		// Bank is full, start over after erasing the sector
+		flash_dp = (char *)0x8000;
+		flash_n = 0;
+		flash_run();
+		hs_state = HSS_ERASE;
 	}
+	else
+		hs_state = HSS_WRITE;
 
-	// All the same
-	return false;
+	frame_job_queue(FJ_HSSAVE, highscore_save_step, HS_LINES);
+}
+
+#else
+
+// No persistence without flash.  The kernal serial routines block for
+// milliseconds per byte and on every sector the drive writes, and they
+// need the kernal IRQ vector, so a disk save cannot be sliced into the
+// frames of the highscore screen like the flash save
+
+inline void highscore_load(void)
+{
+}
+
+inline void highscore_save(void)
+{
 }
 
+#endif
+
 // List of shades of grey
 
 static const char greys[4] = {
@@ -1732,28 +3111,37 @@ bool highscore_show(void)
 
 	music_patch_voice3(true);
 
-	// Make room for highscore in table
-	char hi = 5;
-	while (hi > 0 && highscore_greater(hi - 1))
-	{
-		if (hi != 5)
-			highscores[hi] = highscores[hi - 1];
-		hi--;
-	}
+	// Playfield is gone, the score is shown from the table
+
+	frame_job_cancel(FJ_COLUMN);
+	frame_job_cancel(FJ_COPY);
+	frame_job_cancel(FJ_SCORE);
 
-	// Did we get into the top 5
-	if (hi != 5)
+	// Find place for highscore in table
+	char hi = highscore_rank(score);
+
+	// Did we get into the table
+	if (hi != HIGHSCORES)
 	{
+		// Make room, dropping the last entry
+		memmove(highscores + hi + 1, highscores + hi, (HIGHSCORES - 1 - hi) * sizeof(Highscore));
+
 		// Insert current score into table
-		for(char i=0; i<6; i++)
+		for(char i=0; i<3; i++)
 			highscores[hi].score[i] = score[i];
 		// Insert current name into table
 		for(char i=0; i<3; i++)		
 			highscores[hi].name[i] = highscoreName[i];
 	}
 
+	// First entry of the page to show, and row of the new entry
+	char	hp = 0;
+	if (hi != HIGHSCORES)
+		hp = hi - hi % HIGHSCORE_PAGE;
+	char	hy = 2 * (hi - hp) + 2;
+
 	// Play win or lose music
-	if (hi == 5)		
+	if (hi == HIGHSCORES)		
 		music_init(frand() & 1 ? 3 : 4);
 	else
 		music_init(frand() & 1 ? 2 : 5);
@@ -1825,29 +3213,28 @@ bool highscore_show(void)
 	memset(DynSprites, 0x00, 48 * 64);	
 
 	// Title of highscore screen in top two text rows (first sprite row)
-	if (hi == 5)
+	if (hi == HIGHSCORES)
 	{
 		titlescreen_string(2, 0, "YOU LOST");
 		titlescreen_string(1, 1, "YOUR BALLS");
 	}
 	else
 	{
-		titlescreen_string(3, 0, "A NEW");
-		titlescreen_string(1, 1, "HIGHSCORE");
-	}
-
-	// Highscore names and score into sprites
-	for(char i=0; i<5; i++)
-	{
-		for(char j=0; j<3; j++)
+		// Rank instead of "A NEW" below the top page
+		if (hp == 0)
+			titlescreen_string(3, 0, "A NEW");
+		else
 		{
-			titlescreen_char(j     , 2 * i + 2, highscores[i].name[j]);
-			titlescreen_char(j  + 3, 2 * i + 2, '.');
+			titlescreen_string(2, 0, "RANK ");
+			titlescreen_number(7, 0, hi + 1);
 		}
-		for(char j=0; j<6; j++)
-			titlescreen_char(j +  6, 2 * i + 2, highscores[i].score[j]);
+		titlescreen_string(1, 1, "HIGHSCORE");
 	}
 
+	// Highscore names and score of the page into sprites
+	for(char i=0; i<HIGHSCORE_PAGE; i++)
+		titlescreen_highscore_entry(2 * i + 2, hp + i);
+
 	vic.spr_enable = 0xff;
 
 	// Build deck of cards for scrolling column animation
@@ -1866,17 +3253,13 @@ bool highscore_show(void)
 
 	do {			
 		// First music slot
-		vic_waitTop();
-		music_play();
+		music_slot(0);
 
 		// Move some columns
 		column_down();
 
 		// Second music slot
-		while (vic.raster < 150)
-			;
-
-		music_play();
+		music_slot(1);
 
 		// Move some columns
 		column_down();
@@ -1884,6 +3267,9 @@ bool highscore_show(void)
 		// Wait for bottom
 		vic_waitBottom();
 
+		// Save table in the border, a slice per frame
+		frame_work(FRAME_BORDER_LINES);
+
 		// Check for joystick action
 		joy_poll(0);
 		if (joyx[0] || joyy[0] || joyb[0])
@@ -1895,13 +3281,13 @@ bool highscore_show(void)
 		}
 
 		// We made highscore, so player may enter name
-		if (hi < 5)
+		if (hi < HIGHSCORES)
 		{
 			// Characters for name, or flashing cursor
 			if ((hic & 0x1f) == 0x00)
-				titlescreen_char(hix, 2 * hi + 2, 0x1c);
+				titlescreen_char(hix, hy, 0x1c);
 			else if ((hic & 0x1f) == 0x10)
-				titlescreen_char(hix, 2 * hi + 2, highscores[hi].name[hix]);
+				titlescreen_char(hix, hy, highscores[hi].name[hix]);
 
 			// Next animation phase
 			hic++;
@@ -1937,26 +3323,29 @@ bool highscore_show(void)
 				else if (hix < 2 && (joyb[0] && !down || joyx[0] > 0))
 				{
 					// Next char of 3 letter sequence
-					titlescreen_char(hix, 2 * hi + 2, highscores[hi].name[hix]);
+					titlescreen_char(hix, hy, highscores[hi].name[hix]);
 					hix++;
 					hic = 0xe0;
 				}
 				else if (hix > 0 && joyx[0] < 0)
 				{
 					// Backspace
-					titlescreen_char(hix, 2 * hi + 2, highscores[hi].name[hix]);
+					titlescreen_char(hix, hy, highscores[hi].name[hix]);
 					hix--;
 					hic = 0xe0;
 				}
 				else if (joyb[0] && !down)
 				{
 					// And done
-					titlescreen_char(hix, 2 * hi + 2, highscores[hi].name[hix]);
+					titlescreen_char(hix, hy, highscores[hi].name[hix]);
 
 					// Remember for next time
 					for(char i=0; i<3; i++)		
 						highscoreName[i] = highscores[hi].name[i];
 
+					// Start saving the new table
+					highscore_save();
+
 					// No more entry
 					hi = 0xff;
 				}
@@ -1983,10 +3372,19 @@ bool highscore_show(void)
 
 	} while (title_ty);
 
+	// Name entry timed out, save with the name so far
+	if (hi < HIGHSCORES)
+		highscore_save();
+
+	// Wait for the button release and for a flash save, the sector
+	// erase takes about a second, with the music still playing
 	do {
-		vic_waitFrame();
+		music_slot(0);
+		music_slot(1);
+		vic_waitBottom();
+		frame_work(FRAME_BORDER_LINES);
 		joy_poll(0);
-	} while (joyb[0]);
+	} while (joyb[0] || frame_job_queued(FJ_HSSAVE));
 
 	// Cleanup highscore, fade out
 	for(int i=0; i<4; i++)
@@ -2240,8 +3638,32 @@ void math_init(void)
 		unsigned	s = c * c;
 		sqrtabl[c] = s & 0xff;
 		sqrtabh[c] = s >> 8;
+
+		// Velocity decay split into high and low byte, v = 256 * h + l,
+		// friction v - v / 16 rounds towards zero, so the low byte part
+		// depends on the sign
+		int			f = (sbyte)c * 240;
+		frictll[c] = f & 0xff;
+		frictlh[c] = f >> 8;
+		frictp[c] = c - ((c + 15) >> 4);
+		frictn[c] = c - (c >> 4);
+
+		// Bubble decay v - (v + 2) / 4
+		int			b = (sbyte)c * 192;
+		bubbll[c] = b & 0xff;
+		bubblh[c] = b >> 8;
+		bubblo[c] = c - ((c + 2) >> 2);
+
 		c++;
 	} while (c);
+
+	// Ratio of smaller to larger vector component in 64th, for
+	// larger components in the range of 16 to 31
+	for(char x=0; x<16; x++)
+	{
+		for(char y=0; y<32; y++)
+			nrmtab[x][y] = (((unsigned)y << 6) + ((x + 16) >> 1)) / (x + 16);
+	}
 }
 
 // Rigid body physics of player and iron ball.  Position px/py uses
@@ -2257,6 +3679,31 @@ __zeropage struct Body
 static const unsigned PBITS = 4;
 static const unsigned VBITS = 4;
 
+// Number of links in the chain between player and ball, the three ring
+// sprites are placed on inner link joints, so at least four links are
+// required
+
+#ifndef CHAIN_LINKS
+#define CHAIN_LINKS		4
+#endif
+
+#if CHAIN_LINKS < 4
+#error "CHAIN_LINKS must be at least four"
+#endif
+
+// Position based simulation of the link joints of the chain.  Joint 0
+// is pinned to the player and joint CHAIN_LINKS to the ball, current
+// position px/py and previous position ox/oy use four fractional bits.
+
+struct Chain
+{
+	int		px[CHAIN_LINKS + 1], py[CHAIN_LINKS + 1];
+	int		ox[CHAIN_LINKS + 1], oy[CHAIN_LINKS + 1];
+	char	len;	// Maximum length of one link in pixel
+	bool	back;	// Relax the links from the ball end in this step
+
+}	chain;
+
 // Signed shift by four to the right, using table lookup
 // compiler would use shift and ror to avoid large tables
 
@@ -2268,6 +3715,26 @@ static inline int asr4(int v)
 	return (asrtab4[hv] << 8) | (asltab4[hv] | lsrtab4[lv]);
 }
 
+// Friction of velocity using table lookup of high and low byte
+
+static inline int friction(int v)
+{
+	byte	hv = (unsigned)v >> 8;
+	byte	lv = v & 0xff;
+
+	return ((frictlh[hv] << 8) | frictll[hv]) + (hv & 0x80 ? frictn[lv] : frictp[lv]);
+}
+
+// Strong decay of velocity in bubble mode using table lookup
+
+static inline int bubble(int v)
+{
+	byte	hv = (unsigned)v >> 8;
+	byte	lv = v & 0xff;
+
+	return ((bubblh[hv] << 8) | bubbll[hv]) + bubblo[lv];
+}
+
 // State of the playfield
 
 enum PlayfieldState
@@ -2278,7 +3745,8 @@ enum PlayfieldState
 };
 
 // The playfield has an x position (px) and an x velocity (vx) with
-// four fractional bits.
+// four fractional bits.  The coarse scroll position (cx) is the ring
+// index of the left most screen column in the solid bitmap.
 
 __zeropage struct Playfield
 {
@@ -2457,9 +3925,14 @@ struct Game
 
 // top IRQ: line 58
 // set enemy sprites, 3 * (color, ylow, xlow), xhigh, mcolor
+//
+// first music IRQ: line 70
 // play music
 //
-// center IRQ: line 220
+// center IRQ: line 178
+// switch to bottom font
+//
+// second music IRQ: line 220 (PAL), 201 (NTSC)
 // play music
 //
 // bottom IRQ: line 250
@@ -2467,27 +3940,50 @@ struct Game
 
 __zeropage	char	xspr_msb;
 
-// Expand font and sprite data
+#ifdef MUSIC_PROFILE
+// Max number of raster lines from the top IRQ line to the completion
+// of its sprite writes
+char		irq_top_lines;
+
+__interrupt void irq_top_profile(void)
+{
+	char	r = vic.raster - 58;
+	if (r > irq_top_lines)
+		irq_top_lines = r;
+}
+#endif
+
+// Expand font data
 
 void playfield_init_font(void)
 {
-	oscar_expand_lzo(Font, charset_center);
+	asset_expand(Font, charset_center);
 	memcpy(Font + 0xc0 * 8, charset_front, 64 * 8);
-	oscar_expand_lzo(FontBottom, charset_bottom);
+	asset_expand(FontBottom, charset_bottom);
 	memcpy(FontBottom + 0xc0 * 8, charset_front, 64 * 8);
+}
+
+// Clear dynamic sprite data and screens
+
+void playfield_init_screens(void)
+{
 	memset(DynSprites, 0, 2048);
 
 	memset(Screen0, 0xc1, 1000);
 	memset(Screen1, 0xc1, 1000);
 }
 
-// Init interrupts for game play
+// Build interrupt code for game play
 
 void playfield_initirqs(void)
 {
-	// Top interrupt for game sprites and first music call
+	// Top interrupt for game sprites
 
+#ifdef MUSIC_PROFILE
 	rirq_build(irq_top, 19);
+#else
+	rirq_build(irq_top, 18);
+#endif
 	rirq_write(irq_top, 0, &(vic.spr_pos[5].y), 0);
 	rirq_write(irq_top, 1, &(vic.spr_pos[6].y), 0);
 	rirq_write(irq_top, 2, &(vic.spr_pos[7].y), 0);
@@ -2512,20 +4008,25 @@ void playfield_initirqs(void)
 	rirq_write(irq_top, 16, &vic.spr_multi, 0xff);
 	rirq_write(irq_top, 17, &vic.spr_expand_x, 0x00);
 
-	rirq_call(irq_top, 18, music_play);
-	rirq_set(0, 58, irq_top);
+#ifdef MUSIC_PROFILE
+	rirq_call(irq_top, 18, irq_top_profile);
+#endif
+
+	// Music interrupts on the evenly spaced tick lines, clear of the
+	// top, center and bottom writes, so the variable cost of the player
+	// does not delay them
+
+	for(char i=0; i<5; i++)
+	{
+		rirq_build(irq_music + i, 2);
+		rirq_write(irq_music + i, 0, &music_irq_slot, i);
+		rirq_call(irq_music + i, 1, music_irq);
+	}
 
 	// Center interrupt switching font to bottom set
 
 	rirq_build(&irq_center, 1);
 	rirq_write(&irq_center, 0, &vic.memptr, 0x2a);
-	rirq_set(1, 178, &irq_center);
-
-	// Second music interrupt
-
-	rirq_build(&irq_music, 1);
-	rirq_call(&irq_music, 0, music_play);
-	rirq_set(2, 220, &irq_music);
 
 	// Bottom interrupt for score display
 
@@ -2555,9 +4056,31 @@ void playfield_initirqs(void)
 	rirq_write(irq_bottom, 17, &vic.spr_expand_x, 0xe0);
 
 	rirq_write(irq_bottom, 18, &vic.memptr, 0x28);
+}
+
+// Place the game play interrupts, see playfield_initirqs for their lines
 
+void playfield_startirqs(void)
+{
+	rirq_set(0, 58, irq_top);
+	rirq_set(1, 178, &irq_center);
 	rirq_set(3, 250, irq_bottom);
 
+	// Two music slots in PAL, five in NTSC
+	if (ntsc)
+	{
+		rirq_set(4, music_ntsc_lines[0], irq_music + 0);
+		rirq_set(2, music_ntsc_lines[1], irq_music + 1);
+		for(char i=2; i<5; i++)
+			rirq_set(i + 3, music_ntsc_lines[i], irq_music + i);
+	}
+	else
+	{
+		rirq_set(4, music_pal_lines[0], irq_music + 0);
+		rirq_set(2, music_pal_lines[1], irq_music + 1);
+		for(char i=5; i<8; i++)
+			rirq_clear(i);
+	}
 
 	// sort the raster IRQs
 	rirq_sort();
@@ -2666,15 +4189,25 @@ void xspr_init(void)
 	vic.spr_enable = 0xff;
 }
 
-// Draw one score digit into sprite memory
+// Draw one score digit into sprite memory, positions 0 to 5 are the
+// score, 6 the star symbol and 7 and 8 the number of stars
 
 inline void score_draw(char ci)
 {
 	// Target address in sprite memory
 	char * dp = DynSprites + doffset[ci];
 
+	// Glyph of the digit, digits start at '0' in the font
+	char	g = 0x00;
+	if (ci < 6)
+		g = 0x30 + (ci & 1 ? score[ci >> 1] & 0x0f : score[ci >> 1] >> 4);
+	else if (ci == 7)
+		g = 0x30 + (score_stars >> 4);
+	else if (ci == 8)
+		g = 0x30 + (score_stars & 0x0f);
+
 	// Source address in font
-	const char * sp = charset_digits + 8 * score[ci];
+	const char * sp = charset_digits + 8 * g;
 
 	// Copy 8 lines, sprites have a stride of three
 	dp[ 0] = sp[0];
@@ -2687,16 +4220,57 @@ inline void score_draw(char ci)
 	dp[21] = sp[7];
 }
 
+// Display position of the digits flagged in score_dirty
+
+static const char score_digit[8] = {0, 1, 2, 3, 4, 5, 7, 8};
+
+// Maximum number of digits redrawn per frame, and the raster lines
+// this takes
+#define SCORE_REDRAW	2
+#define SCORE_LINES		4
+
+// Redraw some of the changed digits, least significant first, returns
+// true if digits are left for later frames
+
+bool score_redraw(void)
+{
+	char	n = SCORE_REDRAW;
+	char	i = 8;
+	while (score_dirty && n)
+	{
+		i--;
+		char	m = 1 << i;
+		if (score_dirty & m)
+		{
+			score_dirty &= ~m;
+			score_draw(score_digit[i]);
+			n--;
+		}
+	}
+
+	return score_dirty != 0;
+}
+
+// Queue the redraw of changed digits with the frame scheduler
+
+void score_queue(void)
+{
+	if (score_dirty)
+		frame_job_queue(FJ_SCORE, score_redraw, SCORE_LINES);
+}
+
 // Init score with 000000*00
 
 void score_init(void)
 {
 	// Put zeros
-	for(char i=0; i<9; i++)
-		score[i] = 0x30;
+	score[0] = 0x00;
+	score[1] = 0x00;
+	score[2] = 0x00;
+	score_stars = 0x00;
+	score_dirty = 0x00;
+	frame_job_cancel(FJ_SCORE);
 
-	// Put star
-	score[6] = 0x00;
 	nstars = 1;
 	scorecnt = 0;
 
@@ -2712,7 +4286,17 @@ void score_add(char amount)
 	scorecnt += amount << 8;
 }
 
-// Increment score by one digit at a time
+// Flag changed digits of a score byte for redraw
+
+inline void score_changed(char c, char m)
+{
+	if (c & 0xf0)
+		score_dirty |= m;
+	if (c & 0x0f)
+		score_dirty |= m << 1;
+}
+
+// Increment score by at most ten, with decimal mode adds
 
 void score_inc(void)
 {
@@ -2722,30 +4306,47 @@ void score_inc(void)
 	// New non fractional score to account for
 	if (scorecnt & 0xff00)
 	{
-		// Check for increment of ten column
-		char	c = 5;
+		// Ten or the units as packed BCD
 		if (scorecnt >= 0xa00)
 		{
 			scorecnt -= 0xa00;
-			score[4]++;
-			c = 4;
+			score_delta = 0x10;
 		}
 		else
 		{
-			score[5] += scorecnt >> 8;
+			score_delta = scorecnt >> 8;
 			scorecnt &= 0x00ff;
 		}
-	
-		// Take care of carry
-		while (score[c] >= 0x3a)
+
+		char	s0 = score[0], s1 = score[1], s2 = score[2];
+
+		// Interrupts do not clear the decimal flag, so they are
+		// blocked during the add
+
+		__asm
 		{
-			score[c] -= 10;
-			score_draw(c);
-			c--;
-			score[c]++;		
+			php
+			sei
+			sed
+			clc
+			lda		score + 2
+			adc		score_delta
+			sta		score + 2
+			lda		score + 1
+			adc		#0
+			sta		score + 1
+			lda		score + 0
+			adc		#0
+			sta		score + 0
+			cld
+			plp
 		}
 
-		score_draw(c);
+		// Only digits that changed are drawn later
+		score_changed(s0 ^ score[0], 0x01);
+		score_changed(s1 ^ score[1], 0x04);
+		score_changed(s2 ^ score[2], 0x10);
+		score_queue();
 	}
 }
 
@@ -2756,17 +4357,22 @@ void star_inc(void)
 	nstars++;
 
 	// Update star display
-	score[8]++;
-
-	// Check carry
-	if (score[8] == 0x3a)
+	__asm
 	{
-		score[8] = 0x30;
-		score[7]++;		
-		score_draw(7);
+		php
+		sei
+		sed
+		clc
+		lda		score_stars
+		adc		#1
+		sta		score_stars
+		cld
+		plp
 	}
 
-	score_draw(8);
+	// Check carry
+	score_dirty |= score_stars & 0x0f ? 0x80 : 0xc0;
+	score_queue();
 
 	// Increase weight of ball every four stars
 
@@ -2843,7 +4449,7 @@ void enemies_add(EnemyType type, char y)
 				enemies[nenemy].height = 17;
 				xspr_image(5 + nenemy, 84);
 				xspr_color(5 + nenemy, VCOL_LT_GREY);
-				sidfx_play(2, SIDFXShuriken, 4);
+				sfx_play(SIDFXShuriken, 4);
 				break;
 			case ET_BAT:
 				enemies[nenemy].height = 9;
@@ -3438,13 +5044,42 @@ void playfield_column(void)
 		}
 		ccnt++;
 	}
+
+	// Pack the new column into the solid bitmap, one bit per row,
+	// chars 0xe0 to 0xff are foreground wall
+
+	char	ci = cgen & 63;
+	char	m = 0;
+	for(char i=0; i<25; i++)
+	{
+		m >>= 1;
+		if (scr_column[i] >= 0xe0)
+			m |= 0x80;
+		if ((i & 7) == 7)
+			csolid[i >> 3][ci] = m;
+	}
+	csolid[3][ci] = m >> 7;
+
+	cgen++;
+}
+
+// Bit mask for a row inside a plane of the solid bitmap
+
+static const char solidbit[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+
+// Check for foreground wall at character position of the visible screen
+
+inline bool playfield_solid(char cx, char cy)
+{
+	return (csolid[cy >> 3][(char)(playfield.cx + cx) & 63] & solidbit[cy & 7]) != 0;
 }
 
-// Scroll first screen buffer to the left
+// Scroll the upper rows of the first screen buffer to the left
 
-void playfield_scroll0(void)
+void playfield_scroll0_top(void)
 {
-	// Unroll all vertical and three times horizontal with 13 loop iterations
+	// Unroll all vertical and three times horizontal with 13 loop iterations,
+	// in two halves so a lean frame can leave the second one for later
 
 	for(sbyte x=12; x>=0; x--) 
 	{
@@ -3456,6 +5091,26 @@ void playfield_scroll0(void)
 		#assign rx rx + 1
 		#until rx == 3
 	#assign ry ry + 1
+	#until ry == 13
+	}
+	#undef ry
+	#undef rx
+}
+
+// Scroll the lower rows of the first screen buffer to the left
+
+void playfield_scroll0_bottom(void)
+{
+	for(sbyte x=12; x>=0; x--) 
+	{
+	#assign ry 13
+	#repeat		
+		#assign rx 0
+		#repeat
+			Screen0[40 * ry + 13 * rx + x] = Screen1[40 * ry + 13 * rx + x + 1];
+		#assign rx rx + 1
+		#until rx == 3
+	#assign ry ry + 1
 	#until ry == 25
 	}
 	#undef ry
@@ -3476,9 +5131,9 @@ void playfield_column0(void)
 	#undef ry
 }
 
-// Scroll second screen buffer to the left
+// Scroll the upper rows of the second screen buffer to the left
 
-void playfield_scroll1(void)
+void playfield_scroll1_top(void)
 {
 	for(sbyte x=12; x>=0; x--) 
 	{
@@ -3490,12 +5145,40 @@ void playfield_scroll1(void)
 		#assign rx rx + 1
 		#until rx == 3
 	#assign ry ry + 1
+	#until ry == 13
+	}
+	#undef ry
+	#undef rx
+}
+
+// Scroll the lower rows of the second screen buffer to the left
+
+void playfield_scroll1_bottom(void)
+{
+	for(sbyte x=12; x>=0; x--) 
+	{
+	#assign ry 13
+	#repeat		
+		#assign rx 0
+		#repeat
+			Screen1[40 * ry + 13 * rx + x] = Screen0[40 * ry + 13 * rx + x + 1];
+		#assign rx rx + 1
+		#until rx == 3
+	#assign ry ry + 1
 	#until ry == 25
 	}
 	#undef ry
 	#undef rx
 }
 
+// Scroll second screen buffer to the left
+
+void playfield_scroll1(void)
+{
+	playfield_scroll1_top();
+	playfield_scroll1_bottom();
+}
+
 // Copy the new column to second screen buffer
 
 void playfield_column1(void)
@@ -3613,6 +5296,54 @@ inline unsigned usquare(int i)
 		return csquare(i);
 }
 
+// Unit vector (cos, sin) with seven fractional bits and fractional part
+// of the length (sec - 1) with eight fractional bits for each quantized
+// direction in the first octant
+
+static const char nrmcos[65] = {
+	128, 128, 128, 128, 128, 128, 127, 127, 127, 127, 126, 126, 126, 125, 125, 125,
+	124, 124, 123, 123, 122, 122, 121, 120, 120, 119, 119, 118, 117, 117, 116, 115,
+	114, 114, 113, 112, 112, 111, 110, 109, 109, 108, 107, 106, 105, 105, 104, 103,
+	102, 102, 101, 100, 99, 99, 98, 97, 96, 96, 95, 94, 93, 93, 92, 91,
+	91
+};
+
+static const char nrmsin[65] = {
+	0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 25, 27, 29,
+	31, 33, 35, 36, 38, 40, 42, 43, 45, 47, 48, 50, 51, 53, 54, 56,
+	57, 59, 60, 61, 63, 64, 65, 67, 68, 69, 70, 71, 73, 74, 75, 76,
+	77, 78, 79, 80, 81, 82, 83, 83, 84, 85, 86, 87, 88, 88, 89, 90,
+	91
+};
+
+static const char nrmsec[65] = {
+	0, 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 6, 7,
+	8, 9, 10, 11, 12, 13, 15, 16, 17, 19, 20, 22, 23, 25, 27, 28,
+	30, 32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 55, 57, 59, 62,
+	64, 66, 69, 71, 74, 76, 79, 82, 84, 87, 89, 92, 95, 98, 100, 103,
+	106
+};
+
+// Quantized direction of a vector in the first octant, with ax >= ay > 0
+
+inline char vec_direction(unsigned ax, unsigned ay)
+{
+	// Scale vector until the larger component is in the range 16 to 31
+
+	while (ax >= 32)
+	{
+		ax >>= 1;
+		ay >>= 1;
+	}
+	while (ax < 16)
+	{
+		ax <<= 1;
+		ay <<= 1;
+	}
+
+	return nrmtab[ax - 16][ay];
+}
+
 // Init per game data
 
 void game_init(void)
@@ -3721,6 +5452,16 @@ void player_init(void)
 	game.pulling = false;
 	game.throw = false;
 
+	// All chain joints start at the player position
+
+	for(char i=0; i<=CHAIN_LINKS; i++)
+	{
+		chain.px[i] = chain.ox[i] = player.px;
+		chain.py[i] = chain.oy[i] = player.py;
+	}
+	chain.len = 32 / CHAIN_LINKS;
+	chain.back = false;
+
 	// Prepare player sprites
 
 	xspr_image(0, 64); xspr_color(0, VCOL_ORANGE);
@@ -3730,6 +5471,33 @@ void player_init(void)
 	xspr_image(4, 77); xspr_color(4, VCOL_YELLOW);
 }
 
+// Fraction of a physics step in 1/16 for each accumulator value
+
+static const char physics_fraction[6] = {0, 3, 5, 8, 11, 13};
+
+#ifdef INPUT_PROFILE
+// Raster lines from a change of the joystick to the display of the
+// player sprite at the resulting position, last and maximum, to be read
+// with a monitor
+unsigned	input_lines, input_lines_max;
+
+// CIA 2 timer A at the change, last joystick state and a change that
+// waits for its display
+unsigned	input_time;
+char		input_joy;
+bool		input_pending;
+
+// Start CIA 2 timer A as a free running cycle counter
+void input_timer_start(void)
+{
+	cia2.cra = 0x00;
+	cia2.ta = 0xffff;
+	cia2.cra = 0x11;
+
+	input_pending = false;
+}
+#endif
+
 // Put player sprites on screen
 
 void player_show(void)
@@ -3737,15 +5505,43 @@ void player_show(void)
 	// Player position has four fractional bits, so we need to shift
 	// to get to pixel position
 
-	int	pix = asr4(player.px), piy = asr4(player.py);
-	int bix = asr4(ball.px), biy = asr4(ball.py);
+	int	pix, piy, bix, biy;
+	int	ix1, iy1, ix2, iy2, ix3, iy3;
+
+	// Rings are shown on the inner chain joints at 1/4, 1/2 and 3/4
+	// of the chain
 
+	const char	j1 = (1 * CHAIN_LINKS + 2) / 4;
+	const char	j2 = (2 * CHAIN_LINKS + 2) / 4;
+	const char	j3 = (3 * CHAIN_LINKS + 2) / 4;
 
-	// Interpolate position of rings at 1/4, 1/2 and 3/4 between the two balls
+	char	f = physics_fraction[physics_frac];
+	if (f)
+	{
+		// Part of a physics step has passed since the last step, so
+		// move the sprites along the velocity by the same fraction
+
+		pix = asr4(player.px + (asr4(player.vx) * f >> 4));
+		piy = asr4(player.py + (asr4(player.vy) * f >> 4));
+		bix = asr4(ball.px + (asr4(ball.vx) * f >> 4));
+		biy = asr4(ball.py + (asr4(ball.vy) * f >> 4));
+
+		ix1 = asr4(chain.px[j1] + ((chain.px[j1] - chain.ox[j1]) * f >> 4));
+		iy1 = asr4(chain.py[j1] + ((chain.py[j1] - chain.oy[j1]) * f >> 4));
+		ix2 = asr4(chain.px[j2] + ((chain.px[j2] - chain.ox[j2]) * f >> 4));
+		iy2 = asr4(chain.py[j2] + ((chain.py[j2] - chain.oy[j2]) * f >> 4));
+		ix3 = asr4(chain.px[j3] + ((chain.px[j3] - chain.ox[j3]) * f >> 4));
+		iy3 = asr4(chain.py[j3] + ((chain.py[j3] - chain.oy[j3]) * f >> 4));
+	}
+	else
+	{
+		pix = asr4(player.px); piy = asr4(player.py);
+		bix = asr4(ball.px); biy = asr4(ball.py);
 
-	int ix2 = (pix + bix) >> 1, iy2 = (piy + biy) >> 1;
-	int ix1 = (pix + ix2) >> 1, iy1 = (piy + iy2) >> 1;
-	int ix3 = (ix2 + bix) >> 1, iy3 = (iy2 + biy) >> 1;
+		ix1 = asr4(chain.px[j1]); iy1 = asr4(chain.py[j1]);
+		ix2 = asr4(chain.px[j2]); iy2 = asr4(chain.py[j2]);
+		ix3 = asr4(chain.px[j3]); iy3 = asr4(chain.py[j3]);
+	}
 
 	// Set the five sprites
 
@@ -3757,7 +5553,30 @@ void player_show(void)
 
 	// Atomic update of MSB
 
-	xspr_move_done();
+	xspr_move_done();
+
+#ifdef INPUT_PROFILE
+	if (input_pending)
+	{
+		// Lines since the change, and until the beam reaches the top of
+		// the player sprite, in this or the next frame
+
+		unsigned	l = (input_time - cia2.ta) / (ntsc ? 65 : 63);
+		unsigned	r = vic.raster;
+		if (vic.ctrl1 & VIC_CTRL1_RST8)
+			r += 256;
+		unsigned	y = piy + (50 - 8);
+		if (r < y)
+			l += y - r;
+		else
+			l += (ntsc ? 263 : 312) - r + y;
+
+		input_lines = l;
+		if (l > input_lines_max)
+			input_lines_max = l;
+		input_pending = false;
+	}
+#endif
 }
 
 // Control the player ball with the joystick
@@ -3767,6 +5586,20 @@ void player_control(void)
 	// Read joystick
 	joy_poll(0);
 
+#ifdef INPUT_PROFILE
+	// A change starts a measurement, unless one is still running
+	char	j = (joyx[0] & 3) | ((joyy[0] & 3) << 2) | (joyb[0] ? 0x10 : 0x00);
+	if (j != input_joy)
+	{
+		input_joy = j;
+		if (!input_pending)
+		{
+			input_time = cia2.ta;
+			input_pending = true;
+		}
+	}
+#endif
+
 	// Set image of ball based on direction
 	if (joyx[0] < 0)
 		xspr_image(0, 67 + joyy[0]);
@@ -3840,13 +5673,13 @@ EnemyType player_collision(void)
 	char	cix = (player.px - (4 << PBITS)) >> (3 + PBITS);
 	char	ciy = (player.py - (4 << PBITS)) >> (3 + PBITS);
 
-	// Check for potential character positions for collisions,
-	// chars 0xe0 to 0xff are foreground wall
+	// Check for potential character positions for collisions
+	// using the solid bitmap of the visible columns
 
-	bool	c00 = cscreen[40 * ciy + cix +  0] >= 0xe0;
-	bool	c01 = cscreen[40 * ciy + cix +  1] >= 0xe0;
-	bool	c10 = cscreen[40 * ciy + cix + 40] >= 0xe0;
-	bool	c11 = cscreen[40 * ciy + cix + 41] >= 0xe0;
+	bool	c00 = playfield_solid(cix    , ciy    );
+	bool	c01 = playfield_solid(cix + 1, ciy    );
+	bool	c10 = playfield_solid(cix    , ciy + 1);
+	bool	c11 = playfield_solid(cix + 1, ciy + 1);
 
 	// Check collision from top or bottom, collides with bottom if velocity is positive
 	// and one of the bottom two characters is populated but none of the top two characters
@@ -3926,7 +5759,7 @@ EnemyType player_collision(void)
 						// Star bling bling
 
 						enemies[i].type = ET_RISING_STAR;
-						sidfx_play(2, SIDFXStar, 4);
+						sfx_play(SIDFXStar, 4);
 					}
 					else if (explode == ET_COIN)
 					{
@@ -3934,7 +5767,7 @@ EnemyType player_collision(void)
 
 						enemies[i].type = ET_DROPPING_COIN;
 						enemies[i].phase = 248;
-						sidfx_play(2, SIDFXKatching, 5);
+						sfx_play(SIDFXKatching, 5);
 					}
 					else if (explode == ET_POWERUP)
 					{
@@ -3980,14 +5813,14 @@ EnemyType player_collision(void)
 	// Play boing sound when bouncing
 
 	if (explode == ET_NONE && boing)
-		sidfx_play(2, SIDFXBoing, 1);
+		sfx_play(SIDFXBoing, 1);
 
 	// Return type of collision
 
 	return explode;
 }
 
-// Check collision of ball with enemies
+// Check collision of ball with walls and enemies
 
 void ball_collision(void)
 {
@@ -3998,6 +5831,65 @@ void ball_collision(void)
 		ball.vy = 0;
 	}
 
+	// Check for foreground walls, only if the ball is inside the
+	// visible columns and below the top of the screen
+
+	if (ball.px >= (4 << PBITS) && ball.px < (316 << PBITS) && ball.py >= (4 << PBITS))
+	{
+		// Ball position in character grid coordinates
+
+		char	cix = (ball.px - (4 << PBITS)) >> (3 + PBITS);
+		char	ciy = (ball.py - (4 << PBITS)) >> (3 + PBITS);
+
+		bool	c00 = playfield_solid(cix    , ciy    );
+		bool	c01 = playfield_solid(cix + 1, ciy    );
+		bool	c10 = playfield_solid(cix    , ciy + 1);
+		bool	c11 = playfield_solid(cix + 1, ciy + 1);
+
+		// The heavy iron ball is pushed out of the wall along the
+		// contact normal, completely into the free row or column, and
+		// loses half of its velocity when bouncing off.  A ball pushed
+		// up or left stops one fractional step before the wall cell, so
+		// the next check no longer samples it.
+
+		if ((c10 || c11) && !(c00 || c01))
+		{
+			ball.py = ((8 * ciy + 4) << PBITS) - 1;
+			if (ball.vy > 0)
+				ball.vy = - (ball.vy >> 1);
+		}
+		else if ((c00 || c01) && !(c10 || c11))
+		{
+			ball.py = (8 * ciy + 12) << PBITS;
+			if (ball.vy < 0)
+				ball.vy = - (ball.vy >> 1);
+		}
+		else
+		{
+			// Left right collision relative to the moving walls, the
+			// wall that keeps moving towards the ball pushes it along
+
+			ball.vx += playfield.vx << (PBITS + VBITS - 4);
+			if ((c01 || c11) && !(c00 || c10))
+				ball.px = ((8 * cix + 4) << PBITS) - 1;
+			else if ((c00 || c10) && !(c01 || c11))
+				ball.px = (8 * cix + 12) << PBITS;
+			else if (c00 || c01)
+			{
+				// No free row or column next to the ball, it is buried
+				// in the wall.  It moves with the walls and is carried
+				// up to one column to the left per frame until it is free
+
+				ball.px = ((8 * cix + 4) << PBITS) - 1;
+				ball.vx = 0;
+			}
+
+			if ((c01 || c11) && ball.vx > 0 || (c00 || c10) && ball.vx < 0)
+				ball.vx = - (ball.vx >> 1);
+			ball.vx -= playfield.vx << (PBITS + VBITS - 4);
+		}
+	}
+
 	// Sprite position of ball
 	char	biy = asr4(ball.py) + (50 - 12);
 	int		bix = asr4(ball.px) + (24 - 12);
@@ -4022,13 +5914,79 @@ void ball_collision(void)
 						enemies[i].type = ET_EXPLODE;
 
 					enemies[i].phase = 0;
-					sidfx_play(2, SIDFXExplosion, 1);
+					sfx_play(SIDFXExplosion, 1);
 				}
 			}
 		}
 	}
 }
 
+// Check if the player ball overlaps a foreground wall, positions
+// outside of the screen borders are left to player_collision
+
+bool player_blocked(void)
+{
+	if (player.px < (8 << PBITS) || player.px > (312 << PBITS) ||
+		player.py < (8 << PBITS) || player.py > (192 << PBITS))
+		return false;
+
+	char	cix = (player.px - (4 << PBITS)) >> (3 + PBITS);
+	char	ciy = (player.py - (4 << PBITS)) >> (3 + PBITS);
+
+	return
+		playfield_solid(cix    , ciy    ) || playfield_solid(cix + 1, ciy    ) ||
+		playfield_solid(cix    , ciy + 1) || playfield_solid(cix + 1, ciy + 1);
+}
+
+// Move the player ball.  Movement of more than four pixels relative to
+// the walls, which scroll by playfield.vx until the next check, is
+// split into two or four sub steps along the relative path.  The ball
+// stops its own movement at the first sub step that enters a wall, so
+// it does not tunnel through corners.  A ball that already overlaps a
+// wall moves freely and is resolved by player_collision.
+
+void player_move(int dx, int dy)
+{
+	int			rx = dx + playfield.vx;
+	unsigned	ax = rx < 0 ? -rx : rx;
+	unsigned	ay = dy < 0 ? -dy : dy;
+
+	if ((ax > (4 << PBITS) || ay > (4 << PBITS)) && !player_blocked())
+	{
+		// Two sub steps up to eight pixels, four above
+		char	s = (ax > (8 << PBITS) || ay > (8 << PBITS)) ? 2 : 1;
+		int		sx = dx >> s, sy = dy >> s;
+		int		wx = playfield.vx >> s;
+		int		px = player.px, py = player.py;
+
+		for(char i=(1 << s) - 1; i>0; i--)
+		{
+			// Test the relative position, with the walls moved
+			// towards the ball
+			player.px += sx + wx;
+			player.py += sy;
+			if (player_blocked())
+			{
+				// Back to the last free sub step, without the wall
+				// movement that has not happened yet
+				player.px -= sx + wx;
+				player.py -= sy;
+				player.px -= wx * ((1 << s) - 1 - i);
+				return;
+			}
+		}
+
+		// Last sub step lands on the exact target
+		player.px = px + dx;
+		player.py = py + dy;
+	}
+	else
+	{
+		player.px += dx;
+		player.py += dy;
+	}
+}
+
 // Advance player and ball position
 
 void player_advance(void)
@@ -4037,8 +5995,7 @@ void player_advance(void)
 	// we have to shift the velocity by four to the right
 	// before adding
 
-	player.px += asr4(player.vx);
-	player.py += asr4(player.vy);
+	player_move(asr4(player.vx), asr4(player.vy));
 
 	ball.px += asr4(ball.vx);
 	ball.py += asr4(ball.vy);
@@ -4058,15 +6015,8 @@ void player_physics(void)
 {
 	// Apply friction to player by reducing velocity
 
-	if (player.vx > 0)
-		player.vx -= asr4(player.vx + 15);
-	else if (player.vx < 0)
-		player.vx -= asr4(player.vx);
-
-	if (player.vy > 0)
-		player.vy -= asr4(player.vy + 15);
-	else if (player.vy < 0)
-		player.vy -= asr4(player.vy);
+	player.vx = friction(player.vx);
+	player.vy = friction(player.vy);
 
 	// Let a bit of gravity do its thing
 
@@ -4077,22 +6027,15 @@ void player_physics(void)
 	{
 		// Bubble has significant slow down
 
-		ball.vx -= (ball.vx + 2) >> 2;
-		ball.vy -= (ball.vy + 2) >> 2;
+		ball.vx = bubble(ball.vx);
+		ball.vy = bubble(ball.vy);
 	}
 	else
 	{
 		// Apply friction to ball
 
-		if (ball.vx > 0)
-			ball.vx -= asr4(ball.vx + 15);
-		else if (ball.vx < 0)
-			ball.vx -= asr4(ball.vx);
-
-		if (ball.vy > 0)
-			ball.vy -= asr4(ball.vy + 15);
-		else if (ball.vy < 0)
-			ball.vy -= asr4(ball.vy);
+		ball.vx = friction(ball.vx);
+		ball.vy = friction(ball.vy);
 
 		// Let gravity do its thing
 
@@ -4109,17 +6052,34 @@ void chain_physics(void)
 	int	dx = asr4(ball.px - player.px);
 	int	dy = asr4(ball.py - player.py);
 
-	// Square of length of chain
+	// Reduce to first octant, with the larger component in ax
+
+	unsigned	ax = dx < 0 ? -dx : dx;
+	unsigned	ay = dy < 0 ? -dy : dy;
+
+	bool	swap = ay > ax;
+	if (swap)
+	{
+		unsigned	h = ax; ax = ay; ay = h;
+	}
 
-	unsigned	rq = usquare(dx) + usquare(dy);
+	// Length of links of a slack chain
+
+	chain.len = (game.pulling ? 16 : 32) / CHAIN_LINKS;
 
 	// Chain is not shorted
 
-	if (rq > 0)
+	if (ax > 0)
 	{
-		// Square root to get actual length of chain
+		// Direction and length of chain using table lookup
+
+		char	q = vec_direction(ax, ay);
+		char	r = ax + ((ax * nrmsec[q]) >> 8);
 
-		char	r = tsqrt(rq);
+		// Links of a stretched chain are longer
+
+		if (r > chain.len * CHAIN_LINKS)
+			chain.len = r / CHAIN_LINKS;
 
 		// Calculate target force amount
 
@@ -4143,11 +6103,21 @@ void chain_physics(void)
 
 		if (t)
 		{
-			// Calculate force vector using delta vector and force amount
-			// Multiply normalized vector with force, and restore sign
+			// Calculate force vector using unit vector and force amount,
+			// undo octant reduction and restore sign
+
+			int		fx = (t * nrmcos[q]) >> 7;
+			int		fy = (t * nrmsin[q]) >> 7;
+
+			if (swap)
+			{
+				int	h = fx; fx = fy; fy = h;
+			}
 
-			int		fx = dx < 0 ? -lmuldiv8by8(-dx, t, r) : lmuldiv8by8(dx, t, r);
-			int		fy = dy < 0 ? -lmuldiv8by8(-dy, t, r) : lmuldiv8by8(dy, t, r);
+			if (dx < 0)
+				fx = -fx;
+			if (dy < 0)
+				fy = -fy;
 
 			char 	weight = game.bubble ? 1 : ball.weight;
 
@@ -4166,6 +6136,146 @@ void chain_physics(void)
 	}
 }
 
+// Pull the two joints of link i together if it is longer than the
+// link length
+
+void chain_constrain(char i)
+{
+	int	dx = chain.px[i + 1] - chain.px[i];
+	int	dy = chain.py[i + 1] - chain.py[i];
+
+	// Absolute link vector in pixel, first octant
+
+	int			ix = asr4(dx), iy = asr4(dy);
+	unsigned	ax = ix < 0 ? -ix : ix;
+	unsigned	ay = iy < 0 ? -iy : iy;
+
+	bool	swap = ay > ax;
+	if (swap)
+	{
+		unsigned	h = ax; ax = ay; ay = h;
+	}
+
+	// Quick check with square table, if link is short enough
+
+	if (ax < 128 && csquare(ax) + csquare(ay) <= csquare(chain.len))
+		return;
+
+	// Length of link and excess length, the table length can be
+	// within the link length even if the quick check failed
+
+	char		q = vec_direction(ax, ay);
+	unsigned	r = ax + ((ax * nrmsec[q]) >> 8);
+	if (r <= chain.len)
+		return;
+
+	unsigned	e = r - chain.len;
+	if (e > 127)
+		e = 127;
+
+	// Correction vector with four fractional bits
+
+	int		cx = (e * nrmcos[q]) >> 3;
+	int		cy = (e * nrmsin[q]) >> 3;
+
+	if (swap)
+	{
+		int	h = cx; cx = cy; cy = h;
+	}
+
+	if (dx < 0)
+		cx = -cx;
+	if (dy < 0)
+		cy = -cy;
+
+	// Move joints towards each other, pinned end points do not move
+
+	if (i == 0)
+	{
+		chain.px[1] -= cx;
+		chain.py[1] -= cy;
+	}
+	else if (i == CHAIN_LINKS - 1)
+	{
+		chain.px[i] += cx;
+		chain.py[i] += cy;
+	}
+	else
+	{
+		cx >>= 1;
+		cy >>= 1;
+		chain.px[i] += cx;
+		chain.py[i] += cy;
+		chain.px[i + 1] -= cx;
+		chain.py[i + 1] -= cy;
+	}
+}
+
+#ifdef PHYSICS_PROFILE
+// Max number of raster lines spent in one call of chain_links, to be
+// read with a monitor, about 65 cycles per line on NTSC
+char		chain_lines;
+#endif
+
+// Advance the inner joints of the chain and apply the link constraints
+
+void chain_links(void)
+{
+#ifdef PHYSICS_PROFILE
+	char	rs = vic.raster;
+#endif
+
+	// Pin end points to player and ball, keeping the previous position
+	// like for the inner joints
+
+	chain.ox[0] = chain.px[0];
+	chain.oy[0] = chain.py[0];
+	chain.ox[CHAIN_LINKS] = chain.px[CHAIN_LINKS];
+	chain.oy[CHAIN_LINKS] = chain.py[CHAIN_LINKS];
+
+	chain.px[0] = player.px;
+	chain.py[0] = player.py;
+	chain.px[CHAIN_LINKS] = ball.px;
+	chain.py[CHAIN_LINKS] = ball.py;
+
+	// Verlet integration of inner joints with friction and gravity
+
+	for(char i=1; i<CHAIN_LINKS; i++)
+	{
+		int	vx = chain.px[i] - chain.ox[i];
+		int	vy = chain.py[i] - chain.oy[i];
+
+		chain.ox[i] = chain.px[i];
+		chain.oy[i] = chain.py[i];
+
+		chain.px[i] += vx - asr4(vx);
+		chain.py[i] += vy - asr4(vy) + 2;
+	}
+
+	// One relaxation pass over the links per step, alternating from the
+	// player and from the ball end, so neither end is always corrected
+	// last.  The remaining error carries over into the next step, this
+	// keeps the worst case at CHAIN_LINKS constraints per step
+
+	if (chain.back)
+	{
+		for(char i=CHAIN_LINKS; i>0; i--)
+			chain_constrain(i - 1);
+	}
+	else
+	{
+		for(char i=0; i<CHAIN_LINKS; i++)
+			chain_constrain(i);
+	}
+	chain.back = !chain.back;
+
+#ifdef PHYSICS_PROFILE
+	rs = vic.raster - rs;
+	if (rs > chain_lines)
+		chain_lines = rs;
+#endif
+}
+
 // Initialize the playfield
 
 void playfield_init(void)
@@ -4193,6 +6303,11 @@ void playfield_init(void)
 	cframe = true;
 	cscreen = Screen0;
 
+	// Solid bitmap starts with the first column
+
+	cgen = 0;
+	playfield.cx = 0;
+
 	// Screen and srite colors
 
 	vic.color_back = VCOL_DARK_GREY;
@@ -4239,6 +6354,8 @@ void playfield_init(void)
 
 	// Start scrolling
 
+	frame_job_cancel(FJ_COLUMN);
+	frame_job_cancel(FJ_COPY);
 	playfield_column();
 	playfield_column1();
 	playfield_scroll1();
@@ -4247,6 +6364,47 @@ void playfield_init(void)
 	vic_waitBottom();
 }
 
+// Initial estimates of the raster lines of the variable parts of a game
+// frame, the copies are counted from their cycles at nine cycles per byte
+// plus loops and bad lines
+#define FLIP_LINES		76		// Color ram scroll on screen flip
+#define COPY_LINES		80		// Scroll half of the back buffer
+#define COLUMN_LINES	40		// Build and copy a column
+#define ENEMY_LINES		18		// Move and animate all enemies
+
+// Raster lines of the variable parts, measured each time they run while
+// the game plays and used by the frame jobs and the frame budget governor.
+// A cost rises to a new maximum at once and decays by one line per run,
+// so a rare interrupt hit does not stick.  Start from the estimates
+char		flip_lines = FLIP_LINES, copy_lines = COPY_LINES;
+char		column_lines = COLUMN_LINES, enemy_lines = ENEMY_LINES;
+
+// Current raster line including the ninth bit
+
+inline unsigned frame_raster(void)
+{
+	char	r = vic.raster;
+	return r | ((vic.ctrl1 & VIC_CTRL1_RST8) << 1);
+}
+
+// Update the measured cost of a part that started on raster line start,
+// the part may run across the end of the frame
+
+void frame_cost_update(char * cost, unsigned start)
+{
+	unsigned	r = frame_raster();
+	if (r < start)
+		r += ntsc ? 263 : 312;
+	r -= start;
+
+	if (r > 255)
+		r = 255;
+	if (r >= *cost)
+		*cost = r;
+	else
+		(*cost)--;
+}
+
 // Advance playfield with current speed
 
 void playfield_advance(void)
@@ -4259,24 +6417,61 @@ void playfield_advance(void)
 
 	// Move enemies in parallel
 
+	unsigned	rs = frame_raster();
 	enemies_scroll((char)(playfield.px >> 4) - px);
+	frame_cost_update(&enemy_lines, rs);
 }
 
-// Prepare scrolling of playfield
+// Build the next column and copy it to the back buffer, run as a frame
+// job after the screen flip
 
-void playfield_prescroll(void)
+bool playfield_column_step(void)
 {
-	if (playfield.phase == PPHASE_SCROLLED)
-	{
-		// Create next column
-		playfield_column();
+	unsigned	rs = frame_raster();
 
-		// Copy new column to screen
-		if (cframe)
-			playfield_column1();
-		else
-			playfield_column0();
-	}
+	// Create next column
+	playfield_column();
+
+	// Copy new column to screen
+	if (cframe)
+		playfield_column1();
+	else
+		playfield_column0();
+
+	frame_cost_update(&column_lines, rs);
+
+	return false;
+}
+
+// Scroll the upper half of the back buffer
+
+void playfield_copy_top(void)
+{
+	unsigned	rs = frame_raster();
+
+	if (cframe)
+		playfield_scroll1_top();
+	else
+		playfield_scroll0_top();
+
+	frame_cost_update(&copy_lines, rs);
+}
+
+// Scroll the lower half of the back buffer, run as a frame job when a
+// lean frame only did the upper half
+
+bool playfield_copy_step(void)
+{
+	unsigned	rs = frame_raster();
+
+	if (cframe)
+		playfield_scroll1_bottom();
+	else
+		playfield_scroll0_bottom();
+
+	frame_cost_update(&copy_lines, rs);
+
+	return false;
 }
 
 // Do scroll playfield
@@ -4287,6 +6482,10 @@ void playfield_scroll(void)
 
 	if (playfield.px & 128)
 	{
+		// The back buffer has to be complete before it is shown
+
+		frame_job_finish(FJ_COPY);
+
 		// Remove msb
 		playfield.px &= 127;
 		playfield.phase = PPHASE_SCROLLED;
@@ -4310,8 +6509,16 @@ void playfield_scroll(void)
 
 		cframe = !cframe;
 
+		// Visible columns moved one entry in the solid bitmap
+		playfield.cx++;
+
 		// Scroll color ram
+		unsigned	rs = frame_raster();
 		playfield_scrollc();
+		frame_cost_update(&flip_lines, rs);
+
+		// Next column is built in spare time of the next frame
+		frame_job_queue(FJ_COLUMN, playfield_column_step, column_lines);
 	}
 	else
 	{
@@ -4324,10 +6531,15 @@ void playfield_scroll(void)
 		if (playfield.phase == PPHASE_SCROLLED)
 		{
 			playfield.phase = PPHASE_COPIED;
-			if (cframe)
-				playfield_scroll1();
+			playfield_copy_top();
+
+			// A lean frame leaves the lower half to the spare time of
+			// the next frames, it is finished at the latest on the flip
+
+			if (frame_lean)
+				frame_job_queue(FJ_COPY, playfield_copy_step, copy_lines);
 			else
-				playfield_scroll0();
+				playfield_copy_step();
 		}
 		else
 		{
@@ -4337,6 +6549,122 @@ void playfield_scroll(void)
 	}
 }
 
+// Snapshot of the complete simulation state, to branch and compare the
+// future of a game.  The screen buffers and sprite registers are not part
+// of the snapshot, the solid bitmap represents the playfield for collisions.
+
+struct Snapshot
+{
+	Body		player, ball;
+	Chain		chain;
+	Playfield	playfield;
+	Game		game;
+	Enemy		enemies[3];
+	char		nenemy;
+
+	// Random generator and column generator state
+	unsigned	zseed;
+	char		ctop, cbottom, csize, bimg, bcnt, cimg, ccnt, cdist, cimgy, cgen;
+	EnemyEvent	eventMatrix[64];
+	byte		csolid[4][64];
+
+	// Score and physics clock
+	char		score[3], score_stars, nstars;
+	unsigned	scorecnt;
+	char		physics_acc;
+};
+
+// Save simulation state into snapshot
+
+void snapshot_save(Snapshot * sn)
+{
+	// A pending column is built first, so the generator state is
+	// complete without the job queue
+
+	frame_job_finish(FJ_COLUMN);
+
+	sn->player = player;
+	sn->ball = ball;
+	sn->chain = chain;
+	sn->playfield = playfield;
+	sn->game = game;
+	memcpy(sn->enemies, enemies, sizeof(enemies));
+	sn->nenemy = nenemy;
+
+	sn->zseed = zseed;
+	sn->ctop = ctop;
+	sn->cbottom = cbottom;
+	sn->csize = csize;
+	sn->bimg = bimg;
+	sn->bcnt = bcnt;
+	sn->cimg = cimg;
+	sn->ccnt = ccnt;
+	sn->cdist = cdist;
+	sn->cimgy = cimgy;
+	sn->cgen = cgen;
+	memcpy(sn->eventMatrix, eventMatrix, sizeof(eventMatrix));
+	memcpy(sn->csolid, csolid, sizeof(csolid));
+
+	memcpy(sn->score, score, sizeof(score));
+	sn->score_stars = score_stars;
+	sn->nstars = nstars;
+	sn->scorecnt = scorecnt;
+	sn->physics_acc = physics_acc;
+}
+
+// Restore simulation state from snapshot
+
+void snapshot_restore(const Snapshot * sn)
+{
+	player = sn->player;
+	ball = sn->ball;
+	chain = sn->chain;
+	playfield = sn->playfield;
+	game = sn->game;
+	memcpy(enemies, sn->enemies, sizeof(enemies));
+	nenemy = sn->nenemy;
+
+	zseed = sn->zseed;
+	ctop = sn->ctop;
+	cbottom = sn->cbottom;
+	csize = sn->csize;
+	bimg = sn->bimg;
+	bcnt = sn->bcnt;
+	cimg = sn->cimg;
+	ccnt = sn->ccnt;
+	cdist = sn->cdist;
+	cimgy = sn->cimgy;
+	cgen = sn->cgen;
+	memcpy(eventMatrix, sn->eventMatrix, sizeof(eventMatrix));
+	memcpy(csolid, sn->csolid, sizeof(csolid));
+
+	memcpy(score, sn->score, sizeof(score));
+	score_stars = sn->score_stars;
+	score_dirty = 0xff;
+	nstars = sn->nstars;
+	scorecnt = sn->scorecnt;
+	physics_acc = sn->physics_acc;
+
+	frame_job_cancel(FJ_COLUMN);
+	score_queue();
+}
+
+#ifdef LOW_LATENCY
+// The player sprites have been shown after the physics of this frame
+bool		player_shown;
+
+// Beam in the lower or upper border, above the first line of the
+// player sprites
+bool frame_in_border(void)
+{
+	if (vic.ctrl1 & VIC_CTRL1_RST8)
+		return true;
+
+	char	y = vic.raster;
+	return y >= 250 || y < 40;
+}
+#endif
+
 // Advance game state
 void game_state(GameState state)
 {
@@ -4360,13 +6688,31 @@ void game_state(GameState state)
 			music_init(0);
 			music_patch_voice3(false);
 
-			sidfx_init();
+			sfx_init();
+
+			// Rebuild derived data that is no longer valid
 
-			math_init();
+			if (!(init_valid & INIT_MATH))
+			{
+				math_init();
+				init_valid |= INIT_MATH;
+			}
+
+			if (!(init_valid & INIT_FONT))
+			{
+				playfield_init_font();
+				init_valid |= INIT_FONT;
+			}
+
+			if (!(init_valid & INIT_IRQS))
+			{
+				playfield_initirqs();
+				init_valid |= INIT_IRQS;
+			}
 
-			playfield_init_font();
+			playfield_init_screens();
 
-			playfield_initirqs();
+			playfield_startirqs();
 
 			xspr_init();
 
@@ -4387,13 +6733,21 @@ void game_state(GameState state)
 
 		case GS_PLAYING:
 			player_init();
+			frame_governor_init();
+#ifdef INPUT_PROFILE
+			input_timer_start();
+#endif
+#ifdef LOW_LATENCY
+			player_shown = false;
+#endif
 			game.count = 150;
 			break;
 
 		case GS_EXPLODING:
+			frame_governor_init();
 			player.vx >>= 4;
 			game.count = 0;
-			sidfx_play(2, SIDFXPlayerExplosion, 4);
+			sfx_play(SIDFXPlayerExplosion, 4);
 			break;
 
 		case GS_GAME_OVER:
@@ -4408,6 +6762,100 @@ void game_state(GameState state)
 
 byte rirq_pcount;
 
+// Advance the fixed timestep physics clock by one frame
+
+void physics_tick(void)
+{
+	// Remember the fraction of a step that has not yet been simulated
+	// for display of the player sprites
+
+	physics_frac = physics_acc;
+
+	physics_acc += physics_rate;
+	if (physics_acc >= 6)
+	{
+		physics_acc -= 6;
+		physics_step = true;
+	}
+	else
+		physics_step = false;
+}
+
+// Lines kept in reserve before a frame counts as overrunning
+#define FRAME_MARGIN_LINES	8
+
+// Frame budget governor, the raster lines left when the game loop
+// starts waiting are measured every frame.  Together with the measured
+// cost of that frame they give the headroom for the variable parts, so
+// the next frame can be made lean if its cost does not fit
+
+char		frame_cost, frame_headroom;
+
+void frame_governor_init(void)
+{
+	frame_cost = 0;
+	frame_headroom = 255;
+	frame_lean = false;
+}
+
+// Measure the lines left at the end of the frame work, zero if the raster
+// IRQ already signaled the next frame
+
+void frame_governor_measure(void)
+{
+	unsigned	h = frame_cost;
+	if (rirq_count == rirq_pcount)
+		h += frame_lines_left();
+
+	// Average with the previous frames, limited to the char range
+	h = (h + frame_headroom) >> 1;
+	frame_headroom = h > 255 ? 255 : h;
+}
+
+// Estimate the variable work up to the next wait from the measured costs,
+// after the playfield advanced and before it is scrolled, and decide if it
+// has to be lean
+
+void frame_governor_plan(void)
+{
+	unsigned	lines = enemy_lines;
+	char		extra = 0;
+
+	// Coarse scroll, either the flip with the color scroll and a new
+	// column to build in the next wait, or the copy of the back buffer
+	// in two halves
+
+	bool	copy = false;
+	if (playfield.px & 128)
+	{
+		lines += flip_lines;
+		extra = column_lines;
+	}
+	else if (playfield.phase == PPHASE_SCROLLED)
+	{
+		lines += 2 * copy_lines;
+		copy = true;
+	}
+
+	// A half left by a lean frame is finished before the flip, if the
+	// spare time did not take it
+
+	if (frame_job_queued(FJ_COPY))
+		lines += copy_lines;
+
+	// Only the copy can be deferred, a lean frame leaves its lower half
+	// to the spare time.  Not if the next frame flips already, the half
+	// would only move into the flip frame with the color scroll
+
+	frame_lean =
+		copy && playfield.px + playfield.vx < 128 &&
+		lines + extra + FRAME_MARGIN_LINES > frame_headroom;
+	if (frame_lean)
+		lines -= copy_lines;
+
+	frame_cost = lines > 255 ? 255 : lines;
+}
+
 // Work for current frame
 void game_loop()
 {
@@ -4428,10 +6876,6 @@ void game_loop()
 		break;
 	case GS_PLAYING:		
 
-		// Prepare scrolling
-
-		playfield_prescroll();
-
 //		if (!ntsc)
 		{
 			while ((vic.ctrl1 & VIC_CTRL1_RST8) || vic.raster < 58)
@@ -4442,9 +6886,9 @@ void game_loop()
 
 		playfield_advance();
 
-		// Throttle counters in NTSC mode
+		// Counters advance with the physics clock
 
-		if (physics56 != 4)
+		if (physics_step)
 		{
 			// Advance game level every 3 seconds
 
@@ -4475,18 +6919,36 @@ void game_loop()
 			}
 		}
 
-		// Wait for frame to have passed
+		// Wait for frame to have passed, queued jobs run in the
+		// spare time
+
+		frame_governor_measure();
 
 		while (rirq_count == rirq_pcount)
-			;
+			frame_work(frame_lines_left());
 
 		rirq_pcount = rirq_count;
 
 		while (!(vic.ctrl1 & VIC_CTRL1_RST8) && (char)(vic.raster - 40) < 208)
-			;
+			frame_work(frame_lines_left());
+
+		// Scrolling and collisions need the new column, even if the
+		// frame had no time left for it
+
+		frame_job_finish(FJ_COLUMN);
+
+		// Decide if the work up to the next wait has to be lean
+
+		frame_governor_plan();
 
 		// Show player sprite
+#ifdef LOW_LATENCY
+		if (!player_shown)
+			player_show();
+		player_shown = false;
+#else
 		player_show();
+#endif
 
 		// Scroll the playfield
 
@@ -4494,7 +6956,7 @@ void game_loop()
 
 		// Move the player
 
-		if (physics56 != 3)		
+		if (physics_step)
 		{
 			player_control();
 			player_advance();
@@ -4524,17 +6986,26 @@ void game_loop()
 
 			// Apply game physics
 
-			if (physics56 == 6)
-				physics56 = 0;
-			else
+			if (physics_step)
 			{
 				player_physics();
 				chain_physics();
+				chain_links();
 			}
-		}
 
-		if (ntsc)
-			physics56++;
+#ifdef LOW_LATENCY
+			// Show the result of the joystick in the next frame already,
+			// if the beam has not reached the player sprites yet.  The
+			// fraction of a step is that at the start of the next frame
+
+			if (frame_in_border())
+			{
+				physics_frac = physics_acc;
+				player_show();
+				player_shown = true;
+			}
+#endif
+		}
 
 		break;
 
@@ -4548,12 +7019,18 @@ void game_loop()
 
 		vic_waitTop();
 
+		frame_work(frame_lines_left());
+
 		// Some phyiscs continues
 
-		player_advance();
-		ball_collision();
-		player_exploding();
-		player_physics();
+		if (physics_step)
+		{
+			player_advance();
+			ball_collision();
+			player_exploding();
+			player_physics();
+			chain_links();
+		}
 
 		// Explosion animation
 
@@ -4609,6 +7086,13 @@ void black_screen(void)
 
 int main(void)
 {
+#ifdef CARTRIDGE
+	// Cartridge ROM stays off except for copies, the variables are
+	// behind its window
+	cart_ctrl = CART_CTRL_OFF;
+	mmap_set(MMAP_NO_ROM);
+#endif
+
 	// Turn off CIA interrupts
 	cia_init();
 
@@ -4639,7 +7123,25 @@ int main(void)
 	ntsc = max < 8;
 	minvx = ntsc ? 13 : 16;
 	maxvx = ntsc ? 53 : 64;
+	physics_rate = ntsc ? 5 : 6;
+
 
+#ifdef CARTRIDGE
+	// Copy music, sprites and flash code from their banks
+	cart_copy(2, music, music_rom, 0x2000);
+	cart_copy(3, spriteset, spriteset_rom, 4095);
+	cart_copy(4, (char *)FLASH_CODE, (char *)0x8000, FLASH_CODE_SIZE);
+
+	// Tiles and small charsets go under the ROM window
+	cart_load(5, tileset_center, tiles_rom + TILES_ROM_CENTER, 1024);
+	cart_load(5, charattribs_center, tiles_rom + TILES_ROM_ATTRIBS, 192);
+	cart_load(5, tileset_bottom, tiles_rom + TILES_ROM_BOTTOM, 512);
+	cart_load(5, charset_front, tiles_rom + TILES_ROM_FRONT, 512);
+	cart_load(5, charset_digits, tiles_rom + TILES_ROM_DIGITS, 512);
+#endif
+
+	// Restore saved highscores
+	highscore_load();
 
 	// Copy static spriteset under IO, freeing 0xc000..0xcfff
 	mmap_set(MMAP_CHAR_ROM);
@@ -4662,6 +7164,10 @@ int main(void)
 
 	tileset_init();
 
+#ifdef EXPAND_PROFILE
+	expand_profile();
+#endif
+
 	// Start the game
 
 	game_state(GS_TITLE);
@@ -4669,12 +7175,15 @@ int main(void)
 	// Main game loop
 	for(;;)		
 	{	
+		// Advance the physics clock
+		physics_tick();
+
 		// Increment score 50 times per second
-		if (physics56 != 2)	
+		if (physics_step)
 			score_inc();
 
-		// Advance sound effects
-		sidfx_loop_2();
+		// Allocate voices and advance sound effects
+		sfx_loop();
 
 		// Advance game
 		game_loop();
@@ -1 +1,5 @@
 ..\oscar64\release\oscar64 -n -O2 -xz ballnchain.c
+python tools\prgcrunch.py --verify ballnchain.prg ballnchain-crunched.prg
+python tools\d64build.py --verify ballnchain.d64 ballnchain-crunched.prg
+..\oscar64\release\oscar64 -n -O2 -tf=crt -dCARTRIDGE -o=ballnchain.crt ballnchain.c
+python tools\crtcheck.py ballnchain.crt
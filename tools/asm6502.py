@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Minimal two pass 6502 assembler for the small code fragments of the
+build tools.
+
+A program is a list of tuples, either (label,) or (op, mode) or
+(op, mode, operand).  Operands are numbers or label names.  Modes are
+'' (implied or accumulator), 'imm', 'zp', 'zpx', 'zpy', 'abs', 'absx',
+'absy', 'ind', 'indx', 'indy' and 'rel'.
+"""
+
+# Opcodes by mnemonic and addressing mode
+
+OPCODES = {}
+
+def _def(op, **modes):
+	for mode, code in modes.items():
+		OPCODES[(op, '' if mode == 'imp' else mode)] = code
+
+_def('adc', imm=0x69, zp=0x65, zpx=0x75, abs=0x6d, absx=0x7d, absy=0x79, indx=0x61, indy=0x71)
+_def('and', imm=0x29, zp=0x25, zpx=0x35, abs=0x2d, absx=0x3d, absy=0x39, indx=0x21, indy=0x31)
+_def('asl', imp=0x0a, zp=0x06, zpx=0x16, abs=0x0e, absx=0x1e)
+_def('bit', zp=0x24, abs=0x2c)
+_def('cmp', imm=0xc9, zp=0xc5, zpx=0xd5, abs=0xcd, absx=0xdd, absy=0xd9, indx=0xc1, indy=0xd1)
+_def('cpx', imm=0xe0, zp=0xe4, abs=0xec)
+_def('cpy', imm=0xc0, zp=0xc4, abs=0xcc)
+_def('dec', zp=0xc6, zpx=0xd6, abs=0xce, absx=0xde)
+_def('eor', imm=0x49, zp=0x45, zpx=0x55, abs=0x4d, absx=0x5d, absy=0x59, indx=0x41, indy=0x51)
+_def('inc', zp=0xe6, zpx=0xf6, abs=0xee, absx=0xfe)
+_def('jmp', abs=0x4c, ind=0x6c)
+_def('jsr', abs=0x20)
+_def('lda', imm=0xa9, zp=0xa5, zpx=0xb5, abs=0xad, absx=0xbd, absy=0xb9, indx=0xa1, indy=0xb1)
+_def('ldx', imm=0xa2, zp=0xa6, zpy=0xb6, abs=0xae, absy=0xbe)
+_def('ldy', imm=0xa0, zp=0xa4, zpx=0xb4, abs=0xac, absx=0xbc)
+_def('lsr', imp=0x4a, zp=0x46, zpx=0x56, abs=0x4e, absx=0x5e)
+_def('ora', imm=0x09, zp=0x05, zpx=0x15, abs=0x0d, absx=0x1d, absy=0x19, indx=0x01, indy=0x11)
+_def('rol', imp=0x2a, zp=0x26, zpx=0x36, abs=0x2e, absx=0x3e)
+_def('ror', imp=0x6a, zp=0x66, zpx=0x76, abs=0x6e, absx=0x7e)
+_def('sbc', imm=0xe9, zp=0xe5, zpx=0xf5, abs=0xed, absx=0xfd, absy=0xf9, indx=0xe1, indy=0xf1)
+_def('sta', zp=0x85, zpx=0x95, abs=0x8d, absx=0x9d, absy=0x99, indx=0x81, indy=0x91)
+_def('stx', zp=0x86, zpy=0x96, abs=0x8e)
+_def('sty', zp=0x84, zpx=0x94, abs=0x8c)
+
+for _op, _code in [
+		('brk', 0x00), ('clc', 0x18), ('cld', 0xd8), ('cli', 0x58), ('clv', 0xb8),
+		('dex', 0xca), ('dey', 0x88), ('inx', 0xe8), ('iny', 0xc8), ('nop', 0xea),
+		('pha', 0x48), ('php', 0x08), ('pla', 0x68), ('plp', 0x28), ('rti', 0x40),
+		('rts', 0x60), ('sec', 0x38), ('sed', 0xf8), ('sei', 0x78), ('tax', 0xaa),
+		('tay', 0xa8), ('tsx', 0xba), ('txa', 0x8a), ('txs', 0x9a), ('tya', 0x98)]:
+	OPCODES[(_op, '')] = _code
+
+for _op, _code in [
+		('bpl', 0x10), ('bmi', 0x30), ('bvc', 0x50), ('bvs', 0x70),
+		('bcc', 0x90), ('bcs', 0xb0), ('bne', 0xd0), ('beq', 0xf0)]:
+	OPCODES[(_op, 'rel')] = _code
+
+SIZES = {
+	'': 1, 'imm': 2, 'zp': 2, 'zpx': 2, 'zpy': 2, 'indx': 2, 'indy': 2, 'rel': 2,
+	'abs': 3, 'absx': 3, 'absy': 3, 'ind': 3,
+}
+
+# Base cycles by opcode, without page crossing penalties, branches add
+# one cycle when taken
+
+CYCLES = {}
+
+_MODE_CYCLES = {
+	'': 2, 'imm': 2, 'zp': 3, 'zpx': 4, 'zpy': 4, 'abs': 4, 'absx': 4, 'absy': 4,
+	'indx': 6, 'indy': 5, 'rel': 2, 'ind': 5,
+}
+
+for (_op, _mode), _code in OPCODES.items():
+	c = _MODE_CYCLES[_mode]
+	if _op in ('asl', 'lsr', 'rol', 'ror', 'inc', 'dec') and _mode:
+		c = {'zp': 5, 'zpx': 6, 'abs': 6, 'absx': 7}[_mode]
+	elif _op in ('sta', 'stx', 'sty') and _mode in ('absx', 'absy'):
+		c = 5
+	elif _op == 'sta' and _mode == 'indy':
+		c = 6
+	elif _op == 'jmp':
+		c = 3 if _mode == 'abs' else 5
+	elif _op in ('jsr', 'rts', 'rti'):
+		c = 6
+	elif _op in ('pha', 'php'):
+		c = 3
+	elif _op in ('pla', 'plp'):
+		c = 4
+	elif _op == 'brk':
+		c = 7
+	CYCLES[_code] = c
+
+
+def assemble(org, lines):
+	"""Assemble a list of tuples at address org, returns code and labels"""
+
+	labels = {}
+	pc = org
+	for l in lines:
+		if len(l) == 1:
+			labels[l[0]] = pc
+		else:
+			pc += SIZES[l[1]]
+
+	out = bytearray()
+	pc = org
+	for l in lines:
+		if len(l) == 1:
+			continue
+		op, mode, arg = l if len(l) == 3 else (l[0], l[1], None)
+		if isinstance(arg, str):
+			arg = labels[arg]
+		out.append(OPCODES[(op, mode)])
+		if mode == 'rel':
+			d = arg - (pc + 2)
+			if d < -128 or d > 127:
+				raise ValueError('branch out of range to %04x' % arg)
+			out.append(d & 0xff)
+		elif SIZES[mode] == 2:
+			out.append(arg & 0xff)
+		elif SIZES[mode] == 3:
+			out += (arg & 0xffff).to_bytes(2, 'little')
+		pc += SIZES[mode]
+
+	return bytes(out), labels
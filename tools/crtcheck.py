@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Check the bank layout of the EasyFlash cartridge image.
+
+The game expects its assets in fixed banks of the cartridge, and the
+highscore save erases a whole flash sector.  This checks the image for:
+
+  - an EasyFlash hardware type
+  - a reset vector in the ROMH chip of bank 0, where the cartridge boots
+    in ultimax mode
+  - ROML chips in the asset (1), music (2), sprite (3), flash code (4)
+    and tile (5) banks, with at least the sizes the game copies from them
+  - no chip in the highscore sector, banks 8 to 15, which is erased on
+    the first save
+
+It does not run the boot code, the image still has to be tried in an
+emulator or on the cartridge.
+
+  crtcheck.py ballnchain.crt
+"""
+
+import argparse
+import struct
+import sys
+
+EASYFLASH = 32
+
+BANK_SIZE = 0x2000
+
+# Banks and minimum sizes of the ROML chips the game copies from
+
+REQUIRED = {
+	1: ('assets', 1),
+	2: ('music', 0x2000),
+	3: ('sprites', 4095),
+	4: ('flash code', 0xc8),
+	5: ('tiles', 2752),
+}
+
+# Flash sector with the highscore record
+
+HS_SECTOR = range(8, 16)
+
+
+def parse(data):
+	"""Hardware type and list of chips as bank, load address and image"""
+
+	if data[:16] != b'C64 CARTRIDGE   ':
+		raise ValueError('not a cartridge image')
+
+	hlen = struct.unpack('>I', data[16:20])[0]
+	hwtype = struct.unpack('>H', data[22:24])[0]
+
+	chips = []
+	pos = hlen
+	while pos < len(data):
+		if data[pos:pos + 4] != b'CHIP':
+			raise ValueError('bad chip packet at offset %d' % pos)
+		plen, ctype, bank, load, size = struct.unpack('>IHHHH', data[pos + 4:pos + 16])
+		chips.append((bank, load, data[pos + 16:pos + 16 + size]))
+		pos += plen
+
+	return hwtype, chips
+
+
+def used(image):
+	"""Size up to the last byte that is not erased flash"""
+
+	n = len(image)
+	while n > 0 and image[n - 1] == 0xff:
+		n -= 1
+	return n
+
+
+def check(data):
+	"""Returns a list of problems and a list of report lines"""
+
+	errors = []
+	report = []
+
+	hwtype, chips = parse(data)
+	if hwtype != EASYFLASH:
+		errors.append('hardware type %d is not EasyFlash' % hwtype)
+
+	roml = {}
+	romh = {}
+	for bank, load, image in chips:
+		if len(image) > BANK_SIZE:
+			errors.append('bank %d chip at %04x exceeds 8K' % (bank, load))
+		if load == 0x8000:
+			roml[bank] = image
+		elif load in (0xa000, 0xe000):
+			romh[bank] = image
+		else:
+			errors.append('bank %d chip at unexpected address %04x' % (bank, load))
+
+		if bank in HS_SECTOR and used(image):
+			errors.append('bank %d is in the highscore sector' % bank)
+
+	# Ultimax boot reads the reset vector from ROMH of bank 0
+	if 0 not in romh or len(romh[0]) < BANK_SIZE:
+		errors.append('no 8K ROMH chip in bank 0 for the boot code')
+	else:
+		reset = romh[0][0x1ffc] | (romh[0][0x1ffd] << 8)
+		if reset < 0xe000:
+			errors.append('reset vector %04x is outside of ROMH' % reset)
+		report.append('%-12s reset %04x' % ('boot', reset))
+
+	for bank, (name, size) in sorted(REQUIRED.items()):
+		if bank not in roml:
+			errors.append('no ROML chip in bank %d for the %s' % (bank, name))
+		elif len(roml[bank]) < size:
+			errors.append('bank %d chip of %d bytes is too small for the %s' % (bank, len(roml[bank]), name))
+		else:
+			report.append('%-12s bank %d, %5d of %d bytes' % (name, bank, used(roml[bank]), BANK_SIZE))
+
+	return errors, report
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Check the bank layout of the EasyFlash image')
+	parser.add_argument('crt')
+	args = parser.parse_args()
+
+	with open(args.crt, 'rb') as f:
+		data = f.read()
+
+	try:
+		errors, report = check(data)
+	except ValueError as e:
+		sys.exit('crtcheck: %s' % e)
+
+	for line in report:
+		print(line)
+
+	if errors:
+		for e in errors:
+			print('crtcheck: %s' % e, file=sys.stderr)
+		sys.exit(1)
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,756 @@
+#!/usr/bin/env python3
+"""Build a D64 disk image with a fast loading boot program.
+
+The disk holds a small boot program as its first file, the crunched game
+and optional extra files.  The boot program is loaded with the kernal
+loader.  It sends a drive program with M-W commands and starts it with
+M-E.  The drive program reads the sectors of the extra files and then of
+the game file with the job queue, and sends them two bits at a time on
+the CLK and DATA lines.  Each file goes to its own load address, extra
+files must not overlap the crunched game or the range it expands into.  The
+C64 clocks every bit pair by toggling ATN.  The drive follows the ATN
+level with the ATN acknowledge bit, so the automatic DATA response of
+the drive stays off.
+
+Only the edges of the C64 need to be timed.  The C64 waits a fixed
+number of cycles after each edge before it reads the lines, longer than
+the drive needs to answer.  Badlines, sprites and the video standard
+only make these waits longer.
+
+Blocks are framed by the CLK line: the drive holds CLK low while it
+reads a sector.  When it releases CLK, it sends the number of data bytes
+of the sector, followed by the bytes.  A count of zero ends the file.
+After each block the C64 toggles ATN twice as an acknowledge, and the
+drive pulls CLK low again.
+
+A sector that fails to read is retried a few times.  If it still fails,
+the drive sends a count of 255 instead of the block, and the C64 halts
+with a red border instead of starting a truncated program.
+
+  d64build.py [--verify] ballnchain.d64 ballnchain-crunched.prg [extra ...]
+
+With --verify, the boot is run in a cycle counted simulation of the C64
+and the drive, using the 6502 emulation of sidstream.py.  Kernal serial
+calls and the job queue are simulated.  The run is repeated with an
+NTSC clock for the C64, with the drive 15% slower than nominal, with
+read errors that succeed on a retry and with a sector that never reads.
+This checks the protocol against the model of this tool only, the drive
+ROM, the VIA and the real bus timing are not emulated, so the image
+still has to be tried in an emulator or on a drive.
+"""
+
+import argparse
+import os
+import sys
+
+from asm6502 import assemble, CYCLES
+
+# Disk geometry
+
+def sectors_per_track(t):
+	return 21 if t <= 17 else 19 if t <= 24 else 18 if t <= 30 else 17
+
+TRACKS = 35
+DIR_TRACK = 18
+INTERLEAVE = 10
+
+
+def track_offset(t):
+	return sum(sectors_per_track(i) for i in range(1, t)) * 256
+
+
+def petscii_name(name):
+	return name.upper()[:16].ljust(16, b'\xa0')
+
+
+class Disk:
+	"""D64 image with BAM and directory"""
+
+	def __init__(self, name, id=b'BC'):
+		self.data = bytearray(track_offset(TRACKS + 1))
+		self.free = {t: set(range(sectors_per_track(t))) for t in range(1, TRACKS + 1)}
+		self.files = []
+		self.name = name
+		self.id = id
+		self.free[DIR_TRACK] -= {0, 1}
+
+	def sector(self, t, s):
+		o = track_offset(t) + 256 * s
+		return memoryview(self.data)[o:o + 256]
+
+	def tracks(self):
+		# Tracks closest to the directory first
+		for d in range(1, TRACKS):
+			for t in (DIR_TRACK - d, DIR_TRACK + d):
+				if 1 <= t <= TRACKS:
+					yield t
+
+	def allocate(self, count):
+		"""Sector chain with the standard interleave"""
+
+		chain = []
+		for t in self.tracks():
+			s = 0
+			while self.free[t] and len(chain) < count:
+				n = sectors_per_track(t)
+				while s not in self.free[t]:
+					s = (s + 1) % n
+				self.free[t].remove(s)
+				chain.append((t, s))
+				s = (s + INTERLEAVE) % n
+			if len(chain) == count:
+				return chain
+		raise ValueError('disk full')
+
+	def add(self, name, content, index=None):
+		"""Add a PRG file, returns its first track and sector"""
+
+		blocks = [content[i:i + 254] for i in range(0, len(content), 254)] or [b'']
+		chain = self.allocate(len(blocks))
+		for i, (t, s) in enumerate(chain):
+			sec = self.sector(t, s)
+			if i + 1 < len(chain):
+				sec[0], sec[1] = chain[i + 1]
+			else:
+				sec[0], sec[1] = 0, len(blocks[i]) + 1
+			sec[2:2 + len(blocks[i])] = blocks[i]
+		self.files.insert(len(self.files) if index is None else index, (name, chain[0], len(chain)))
+		return chain[0]
+
+	def finish(self):
+		"""Write directory and BAM"""
+
+		if len(self.files) > 8:
+			raise ValueError('too many files')
+
+		d = self.sector(DIR_TRACK, 1)
+		d[0], d[1] = 0, 0xff
+		for i, (name, (t, s), blocks) in enumerate(self.files):
+			e = d[32 * i:32 * i + 32]
+			e[2] = 0x82
+			e[3], e[4] = t, s
+			e[5:21] = petscii_name(name)
+			e[30], e[31] = blocks & 0xff, blocks >> 8
+
+		b = self.sector(DIR_TRACK, 0)
+		b[0], b[1], b[2] = DIR_TRACK, 1, 0x41
+		for t in range(1, TRACKS + 1):
+			bits = sum(1 << s for s in self.free[t])
+			b[4 * t:4 * t + 4] = bytes([len(self.free[t]), bits & 0xff, (bits >> 8) & 0xff, bits >> 16])
+		b[0x90:0xa0] = petscii_name(self.name)
+		b[0xa0:0xa2] = b'\xa0\xa0'
+		b[0xa2:0xa4] = self.id
+		b[0xa4] = 0xa0
+		b[0xa5:0xa7] = b'2A'
+		b[0xa7:0xab] = b'\xa0' * 4
+
+		return bytes(self.data)
+
+
+def read_file(image, t, s):
+	"""Follow a sector chain of an image"""
+
+	out = bytearray()
+	while True:
+		o = track_offset(t) + 256 * s
+		sec = image[o:o + 256]
+		if sec[0] == 0:
+			return bytes(out + sec[2:sec[1] + 1])
+		out += sec[2:]
+		t, s = sec[0], sec[1]
+
+
+# Drive program in buffers 2 and 3, its variables in buffer 4, sectors
+# are read into buffer 0
+
+DRIVE = 0x0500
+DRIVE_TMP = 0x0700
+
+# C64 receiver in the cassette buffer, zero page it uses
+
+RECEIVER = 0x0334
+ZP_HDR, ZP_PTR, ZP_CNT, ZP_TMP, ZP_BANK, ZP_ATN, ZP_FILES = 0x02, 0xfb, 0xfd, 0xfe, 0x9e, 0x9f, 0x9b
+
+# Reads of a sector before the load fails, and the block count that
+# reports the failure
+
+RETRIES = 4
+LOAD_ERROR = 0xff
+
+# Delay loop counts of the receiver, five cycles each.  The first bit
+# pair of a byte waits for the drive to fetch and prepare the byte.
+
+DELAY_BYTE = 28
+DELAY_BITS = 6
+
+# Kernal serial routines
+
+LISTEN, SECOND, CIOUT, UNLSN = 0xffb1, 0xff93, 0xffa8, 0xffae
+
+
+def drive_code(files):
+	"""Sector reader and two bit sender, runs at DRIVE, sends the files
+	starting at the given tracks and sectors in order"""
+
+	p = [DRIVE_TMP + i for i in range(4)]
+	tmp, cnt, index, retry = DRIVE_TMP + 4, DRIVE_TMP + 5, DRIVE_TMP + 6, DRIVE_TMP + 7
+
+	lines = [
+		('sei', ''),
+		('lda', 'imm', 0x02),		# Disable ATN interrupt
+		('sta', 'abs', 0x180e),
+		('lda', 'imm', 0x08),		# CLK low, busy
+		('sta', 'abs', 0x1800),
+		('lda', 'imm', 0),
+		('sta', 'abs', index),
+
+		('file',),					# Next file from the table
+		('ldx', 'abs', index),
+		('lda', 'absx', 'files'),
+		('bne', 'rel', 'more'),
+		('jmp', 'abs', 'exit'),
+		('more',),
+		('inx', ''),
+		('ldy', 'absx', 'files'),
+		('inx', ''),
+		('stx', 'abs', index),
+		('tax', ''),
+
+		('sector',),
+		('stx', 'zp', 0x06),
+		('sty', 'zp', 0x07),
+		('lda', 'imm', RETRIES),
+		('sta', 'abs', retry),
+		('read',),
+		('cli', ''),
+		('lda', 'imm', 0x80),		# Read job for buffer 0 at 0x0300
+		('sta', 'zp', 0x00),
+		('wait',),
+		('lda', 'zp', 0x00),
+		('bmi', 'rel', 'wait'),
+		('sei', ''),
+		('cmp', 'imm', 0x02),
+		('bcc', 'rel', 'ok'),
+		('dec', 'abs', retry),
+		('bne', 'rel', 'read'),
+
+		('lda', 'imm', LOAD_ERROR),	# Report the failed sector
+		('jsr', 'abs', 'prep'),
+		('lda', 'imm', 0x00),
+		('sta', 'abs', 0x1800),
+		('jsr', 'abs', 'xmit'),
+		('jsr', 'abs', 'ack'),
+		('jmp', 'abs', 'exit'),
+
+		('ok',),
+
+		('lda', 'imm', 254),		# Full sector or last sector
+		('ldx', 'abs', 0x0300),
+		('bne', 'rel', 'full'),
+		('lda', 'abs', 0x0301),
+		('sec', ''),
+		('sbc', 'imm', 1),
+		('full',),
+		('sta', 'abs', cnt),
+
+		('jsr', 'abs', 'prep'),		# CLK released, ready to send
+		('lda', 'imm', 0x00),
+		('sta', 'abs', 0x1800),
+		('jsr', 'abs', 'xmit'),
+		('ldx', 'imm', 2),
+		('bytes',),
+		('lda', 'absx', 0x0300),
+		('jsr', 'abs', 'send'),
+		('inx', ''),
+		('dec', 'abs', cnt),
+		('bne', 'rel', 'bytes'),
+		('jsr', 'abs', 'ack'),
+
+		('ldx', 'abs', 0x0300),
+		('ldy', 'abs', 0x0301),
+		('txa', ''),
+		('beq', 'rel', 'done'),
+		('jmp', 'abs', 'sector'),
+
+		('done',),
+		('lda', 'imm', 0x00),		# Empty block ends the file
+		('jsr', 'abs', 'prep'),
+		('lda', 'imm', 0x00),
+		('sta', 'abs', 0x1800),
+		('jsr', 'abs', 'xmit'),
+		('jsr', 'abs', 'ack'),
+		('jmp', 'abs', 'file'),
+
+		('exit',),
+		('lda', 'imm', 0x82),		# Enable ATN interrupt
+		('sta', 'abs', 0x180e),
+		('lda', 'imm', 0x00),
+		('sta', 'abs', 0x1800),
+		('cli', ''),
+		('rts', ''),
+
+		# Acknowledge, ATN asserted and released again
+
+		('ack',),
+		('bit', 'abs', 0x1800),
+		('bpl', 'rel', 'ack'),
+		('lda', 'imm', 0x18),
+		('sta', 'abs', 0x1800),
+		('ack1',),
+		('bit', 'abs', 0x1800),
+		('bmi', 'rel', 'ack1'),
+		('lda', 'imm', 0x08),
+		('sta', 'abs', 0x1800),
+		('rts', ''),
+
+		# Send byte in A
+
+		('send',),
+		('jsr', 'abs', 'prep'),
+	]
+
+	for i in range(4):
+		lines += [
+			('s%d' % i,) if i else ('xmit',),
+			('bit', 'abs', 0x1800),
+			('bpl' if i % 2 == 0 else 'bmi', 'rel', 's%d' % i if i else 'xmit'),
+			('lda', 'abs', p[i]),
+			('sta', 'abs', 0x1800),
+		]
+
+	lines += [
+		('rts', ''),
+
+		# Prepare byte in A, inverted because the outputs pull the lines low
+
+		('prep',),
+		('eor', 'imm', 0xff),
+		('sta', 'abs', tmp),
+	]
+
+	# Line values of the four bit pairs, DATA bit 1 and CLK bit 3, with
+	# ATN acknowledge matching the ATN level of the pair
+
+	for i in range(4):
+		lines += [
+			('lda', 'imm', 0x10 if i % 2 == 0 else 0x00),
+			('asl', 'abs', tmp),
+			('bcc', 'rel', 'pd%d' % i),
+			('ora', 'imm', 0x02),
+			('pd%d' % i,),
+			('asl', 'abs', tmp),
+			('bcc', 'rel', 'pc%d' % i),
+			('ora', 'imm', 0x08),
+			('pc%d' % i,),
+			('sta', 'abs', p[i]),
+		]
+
+	lines += [('rts', ''), ('files',)]
+
+	table = bytearray()
+	for t, s in files:
+		table += bytes([t, s])
+	table.append(0)
+
+	return assemble(DRIVE, lines)[0] + table
+
+
+def receiver_code(entry, count):
+	"""Fast load receiver, runs at RECEIVER, receives count files and
+	starts the loaded program, returns code and address of the error exit"""
+
+	def delay(n, label):
+		return [('ldx', 'imm', n), (label,), ('dex', ''), ('bne', 'rel', label)]
+
+	def bits():
+		return [('lda', 'abs', 0xdd00), ('asl', ''), ('rol', 'zp', ZP_TMP), ('asl', ''), ('rol', 'zp', ZP_TMP)]
+
+	lines = [
+		('lda', 'abs', 0xdd00),		# Keep VIC bank, release all lines
+		('and', 'imm', 0x03),
+		('sta', 'zp', ZP_BANK),
+		('ora', 'imm', 0x08),
+		('sta', 'zp', ZP_ATN),
+		('lda', 'zp', ZP_BANK),
+		('sta', 'abs', 0xdd00),
+		('lda', 'imm', count),
+		('sta', 'zp', ZP_FILES),
+
+		('start',),
+		('lda', 'imm', 0),
+		('sta', 'zp', ZP_HDR),
+
+		('busy',),					# Drive program running
+		('bit', 'abs', 0xdd00),
+		('bvs', 'rel', 'busy'),
+
+		('block',),					# Sector ready
+		('bit', 'abs', 0xdd00),
+		('bvc', 'rel', 'block'),
+		('jsr', 'abs', 'get'),
+		('sta', 'zp', ZP_CNT),
+		('beq', 'rel', 'fin'),
+		('cmp', 'imm', LOAD_ERROR),
+		('beq', 'rel', 'error'),
+
+		('byte',),
+		('jsr', 'abs', 'get'),
+		('ldx', 'zp', ZP_HDR),		# Load address first
+		('cpx', 'imm', 2),
+		('bcs', 'rel', 'store'),
+		('sta', 'zpx', ZP_PTR),
+		('inc', 'zp', ZP_HDR),
+		('bne', 'rel', 'next'),
+		('store',),
+		('ldy', 'imm', 0),
+		('sta', 'indy', ZP_PTR),
+		('inc', 'zp', ZP_PTR),
+		('bne', 'rel', 'next'),
+		('inc', 'zp', ZP_PTR + 1),
+		('next',),
+		('dec', 'zp', ZP_CNT),
+		('bne', 'rel', 'byte'),
+		('jsr', 'abs', 'ack'),
+		('jmp', 'abs', 'block'),
+
+		('fin',),
+		('jsr', 'abs', 'ack'),
+		('dec', 'zp', ZP_FILES),
+		('bne', 'rel', 'start'),
+		('cli', ''),
+		('jmp', 'abs', entry),
+
+		('error',),					# Red border and halt
+		('lda', 'imm', 0x02),
+		('sta', 'abs', 0xd020),
+		('hang',),
+		('bne', 'rel', 'hang'),
+
+		('ack',),
+		('lda', 'zp', ZP_ATN),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BITS, 'ackd0') + [
+		('lda', 'zp', ZP_BANK),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BITS, 'ackd1') + [
+		('rts', ''),
+
+		('get',),
+		('lda', 'zp', ZP_ATN),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BYTE, 'getd0') + bits() + [
+		('lda', 'zp', ZP_BANK),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BITS, 'getd1') + bits() + [
+		('lda', 'zp', ZP_ATN),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BITS, 'getd2') + bits() + [
+		('lda', 'zp', ZP_BANK),
+		('sta', 'abs', 0xdd00),
+	] + delay(DELAY_BITS, 'getd3') + bits() + [
+		('lda', 'zp', ZP_TMP),
+		('rts', ''),
+	]
+
+	code, labels = assemble(RECEIVER, lines)
+	return code, labels['error']
+
+
+def boot_program(files, entry):
+	"""BASIC SYS line, drive program upload and receiver start, loads the
+	files at the given tracks and sectors, returns the program and the
+	address of the load error exit"""
+
+	drive = drive_code(files)
+	drive += bytes(-len(drive) % 32)
+	if DRIVE + len(drive) > DRIVE_TMP:
+		raise ValueError('drive program too large')
+	receiver, error = receiver_code(entry, len(files))
+	if RECEIVER + len(receiver) > 0x03fc:
+		raise ValueError('receiver too large')
+
+	line = bytes([0x9e]) + b'2061' + bytes([0])
+	basic = (0x0801 + 4 + len(line)).to_bytes(2, 'little') + (10).to_bytes(2, 'little') + line + bytes([0, 0])
+
+	def command(text):
+		out = [('lda', 'imm', 8), ('jsr', 'abs', LISTEN), ('lda', 'imm', 0x6f), ('jsr', 'abs', SECOND)]
+		for c in text:
+			out += [('lda', 'imm', c), ('jsr', 'abs', CIOUT)]
+		return out
+
+	def code(dsrc, rsrc):
+		return [
+			('ldx', 'imm', 0),			# Receiver into the cassette buffer
+			('rcopy',),
+			('lda', 'absx', rsrc),
+			('sta', 'absx', RECEIVER),
+			('inx', ''),
+			('cpx', 'imm', len(receiver)),
+			('bne', 'rel', 'rcopy'),
+
+			('lda', 'imm', dsrc & 0xff),
+			('sta', 'zp', ZP_PTR),
+			('lda', 'imm', dsrc >> 8),
+			('sta', 'zp', ZP_PTR + 1),
+			('lda', 'imm', DRIVE & 0xff),
+			('sta', 'zp', ZP_CNT),
+			('lda', 'imm', DRIVE >> 8),
+			('sta', 'zp', ZP_TMP),
+			('lda', 'imm', len(drive) // 32),
+			('sta', 'zp', ZP_BANK),
+
+			('chunk',),					# M-W of 32 bytes
+		] + command(b'M-W') + [
+			('lda', 'zp', ZP_CNT),
+			('jsr', 'abs', CIOUT),
+			('lda', 'zp', ZP_TMP),
+			('jsr', 'abs', CIOUT),
+			('lda', 'imm', 32),
+			('jsr', 'abs', CIOUT),
+			('lda', 'imm', 0),
+			('sta', 'zp', ZP_HDR),
+			('data',),
+			('ldy', 'zp', ZP_HDR),
+			('lda', 'indy', ZP_PTR),
+			('jsr', 'abs', CIOUT),
+			('inc', 'zp', ZP_HDR),
+			('lda', 'zp', ZP_HDR),
+			('cmp', 'imm', 32),
+			('bne', 'rel', 'data'),
+			('jsr', 'abs', UNLSN),
+			('clc', ''),
+			('lda', 'zp', ZP_PTR),
+			('adc', 'imm', 32),
+			('sta', 'zp', ZP_PTR),
+			('bcc', 'rel', 'nohi'),
+			('inc', 'zp', ZP_PTR + 1),
+			('nohi',),
+			('clc', ''),
+			('lda', 'zp', ZP_CNT),
+			('adc', 'imm', 32),
+			('sta', 'zp', ZP_CNT),
+			('bcc', 'rel', 'nodhi'),
+			('inc', 'zp', ZP_TMP),
+			('nodhi',),
+			('dec', 'zp', ZP_BANK),
+			('beq', 'rel', 'exec'),
+			('jmp', 'abs', 'chunk'),
+
+			('exec',),
+		] + command(b'M-E' + bytes([DRIVE & 0xff, DRIVE >> 8])) + [
+			('jsr', 'abs', UNLSN),
+			('sei', ''),
+			('jmp', 'abs', RECEIVER),
+		]
+
+	org = 0x0801 + len(basic)
+	size = len(assemble(org, code(0, 0))[0])
+	loader = assemble(org, code(org + size, org + size + len(drive)))[0]
+
+	return (0x0801).to_bytes(2, 'little') + basic + loader + drive + receiver, error
+
+
+# Simulation of C64 and drive for --verify
+
+class Bus:
+	"""Serial bus lines, True when pulled low"""
+
+	def __init__(self):
+		self.host = 0x03
+		self.drive = 0x00
+
+	def atn(self):
+		return bool(self.host & 0x08)
+
+	def clk(self):
+		return bool(self.host & 0x10) or bool(self.drive & 0x08)
+
+	def data(self):
+		return bool(self.host & 0x20) or bool(self.drive & 0x02) or (self.atn() != bool(self.drive & 0x10))
+
+
+def simulate(boot, image, entry, error, drive_hz, host_hz=985248, failures=None):
+	"""Run the boot program until it starts the loaded program or reaches
+	the error exit, returns the host memory, the elapsed time in seconds
+	and whether the load failed.  failures maps a track and sector to the
+	number of reads that fail before it reads"""
+
+	failures = dict(failures or {})
+
+	from sidstream import CPU6502
+
+	bus = Bus()
+	host_mem = bytearray(0x10000)
+	drive_mem = bytearray(0x10000)
+	host_mem[0x0801:0x0801 + len(boot) - 2] = boot[2:]
+
+	class Host(CPU6502):
+		def rd(self, a):
+			a &= 0xffff
+			if a == 0xdd00:
+				return (bus.host & 0x3f) | (0 if bus.clk() else 0x40) | (0 if bus.data() else 0x80)
+			return self.mem[a]
+
+	class Drive(CPU6502):
+		def rd(self, a):
+			a &= 0xffff
+			if a == 0x1800:
+				v = bus.drive & 0x7a
+				return v | (0x01 if bus.data() else 0) | (0x04 if bus.clk() else 0) | (0x80 if bus.atn() else 0)
+			if a == 0x0000 and job[0] is not None and drive_cycles[0] >= job[0]:
+				t, s = self.mem[6], self.mem[7]
+				if failures.get((t, s), 0):
+					failures[(t, s)] -= 1
+					self.mem[0] = 0x05
+				else:
+					o = track_offset(t) + 256 * s
+					self.mem[0x0300:0x0400] = image[o:o + 256]
+					self.mem[0] = 0x01
+				job[0] = None
+			return self.mem[a]
+
+	def host_write(a, v):
+		if a == 0xdd00:
+			bus.host = v
+
+	def drive_write(a, v):
+		if a == 0x1800:
+			bus.drive = v
+		elif a == 0x0000 and v == 0x80:
+			job[0] = drive_cycles[0] + 8000
+
+	job = [None]
+	drive_cycles = [0]
+	host = Host(host_mem, host_write)
+	drive = Drive(drive_mem, drive_write)
+	host.pc = 2061
+	host_cycles = 0
+	drive_running = False
+	command = bytearray()
+
+	def cycles(cpu, before):
+		op = cpu.mem[before]
+		c = CYCLES.get(op, 4)
+		if op & 0x1f == 0x10 and cpu.pc != ((before + 2) & 0xffff):
+			c += 1
+		return c
+
+	while True:
+		if host.pc in (entry, error) and host_cycles > 0:
+			return host_mem, host_cycles / host_hz, host.pc == error
+
+		if not drive_running or host_cycles / host_hz <= drive_cycles[0] / drive_hz:
+			if host.pc in (LISTEN, SECOND, CIOUT, UNLSN):
+				if host.pc == CIOUT:
+					command.append(host.a)
+				elif host.pc == UNLSN:
+					if command[:3] == b'M-W':
+						a, n = command[3] | (command[4] << 8), command[5]
+						drive_mem[a:a + n] = command[6:6 + n]
+					elif command[:3] == b'M-E':
+						drive.pc = command[3] | (command[4] << 8)
+						drive.push(0xff)
+						drive.push(0xfe)
+						drive_cycles[0] = host_cycles * drive_hz / host_hz
+						drive_running = True
+					command = bytearray()
+				lo = host.pull()
+				hi = host.pull()
+				host.pc = ((hi << 8) | lo) + 1
+				host_cycles += 1000
+				continue
+			pc = host.pc
+			host.step()
+			host_cycles += cycles(host, pc)
+			if host_cycles > host_hz * 30:
+				raise RuntimeError('host timeout')
+		else:
+			if drive.pc == 0xffff:
+				drive_running = False
+				continue
+			pc = drive.pc
+			drive.step()
+			drive_cycles[0] += cycles(drive, pc)
+
+
+def verify(boot, image, files, entry, error):
+	"""Simulate the load with several clocks and read errors, returns the
+	name of the first failing run or None"""
+
+	contents = [read_file(image, t, s) for t, s in files]
+	size = sum(len(c) for c in contents)
+
+	# Every first sector fails twice, the last sector of the game never
+	# reads
+	retried = {f: RETRIES - 2 for f in files}
+	t, s = files[-1]
+	while image[track_offset(t) + 256 * s]:
+		o = track_offset(t) + 256 * s
+		t, s = image[o], image[o + 1]
+	broken = {(t, s): RETRIES}
+
+	runs = [
+		('PAL', 985248, 1000000, None, False),
+		('NTSC', 1022727, 1000000, None, False),
+		('slow drive', 985248, 850000, None, False),
+		('retried reads', 985248, 1000000, retried, False),
+		('failed read', 985248, 1000000, broken, True),
+	]
+
+	for name, host_hz, drive_hz, failures, fails in runs:
+		try:
+			mem, seconds, failed = simulate(boot, image, entry, error, drive_hz, host_hz, failures)
+		except RuntimeError:
+			return name
+		if failed != fails:
+			return name
+		if not fails:
+			for c in contents:
+				load = c[0] | (c[1] << 8)
+				if bytes(mem[load:load + len(c) - 2]) != c[2:]:
+					return name
+		print('%-14s c64 at %5.3f MHz, drive at %4.2f MHz: %5d bytes in %5.2f s, %5.0f bytes/s%s' %
+			(name, host_hz / 1e6, drive_hz / 1e6, size, seconds, size / seconds, ', load error' if failed else ''))
+	return None
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Build a fast loading D64 image')
+	parser.add_argument('output')
+	parser.add_argument('game', help='crunched game PRG')
+	parser.add_argument('extras', nargs='*', help='additional files')
+	parser.add_argument('--verify', action='store_true', help='simulate the fast load of the game')
+	args = parser.parse_args()
+
+	with open(args.game, 'rb') as f:
+		game = f.read()
+
+	disk = Disk(b'BALLNCHAIN')
+
+	# Game and extras first to know their locations, the boot program is
+	# still the first directory entry.  Extras are loaded before the game,
+	# which starts when the last file is in
+
+	files = []
+	for name in args.extras:
+		with open(name, 'rb') as f:
+			files.append(disk.add(os.path.splitext(os.path.basename(name))[0].encode('ascii'), f.read()))
+	files.append(disk.add(b'BNC.GAME', game, 0))
+	boot, error = boot_program(files, 2061)
+	disk.add(b'BALLNCHAIN', boot, 0)
+
+	image = disk.finish()
+
+	if args.verify:
+		failed = verify(boot, image, files, 2061, error)
+		if failed:
+			sys.exit('d64build: fast load failed in the %s run' % failed)
+
+	with open(args.output, 'wb') as f:
+		f.write(image)
+
+	print('%s: %d blocks free' % (args.output, sum(len(s) for t, s in disk.free.items() if t != DIR_TRACK)))
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""Compress binary assets into the lzf format expanded by expand_lzf in
+ballnchain.c.
+
+  lzfpack.py [--bench] <output> <input>[:<offset>:<size>] ...
+
+Each input part becomes one stream with its own end marker, so several
+parts of a file can be expanded to different targets in sequence, the
+same way as consecutive #embed lzo lines.
+
+Stream format, all tokens byte aligned:
+
+  0x00            end of stream
+  0x01-0x7f       literal run of n bytes, followed by the bytes
+  0x80-0xbf o     match of (n & 0x3f) + 2 bytes at distance o + 1
+  0xc0-0xff lo hi match of (n & 0x3f) + 3 bytes, negative distance
+
+The encoder uses an optimal parse for size.  With --bench, the size and
+the decode time of each part is printed.  The time is estimated from
+the instruction timings of the 6502 decoder, without page crossings.
+"""
+
+import argparse
+import sys
+
+MAX_LITERAL = 0x7f
+SHORT_MIN, SHORT_MAX, SHORT_DIST = 2, 0x3f + 2, 256
+LONG_MIN, LONG_MAX, LONG_DIST = 3, 0x3f + 3, 0xffff
+
+# Cycles of the decoder per token and per copied byte
+
+CYCLES_LITERAL = 45
+CYCLES_SHORT = 80
+CYCLES_LONG = 82
+CYCLES_BYTE = 19
+CYCLES_END = 20
+
+
+def longest_matches(data, i, chains, window):
+	"""Longest match with a short and with a long distance at position i"""
+
+	n = len(data)
+	best_short = (0, 0)
+	best_long = (0, 0)
+	if i + 1 >= n:
+		return best_short, best_long
+
+	key = data[i] | (data[i + 1] << 8)
+	for j in reversed(chains.get(key, [])[-window:]):
+		d = i - j
+		if d > LONG_DIST:
+			break
+		m = 2
+		limit = min(LONG_MAX, n - i)
+		while m < limit and data[j + m] == data[i + m]:
+			m += 1
+		if d <= SHORT_DIST and m > best_short[0]:
+			best_short = (min(m, SHORT_MAX), d)
+		if m > best_long[0]:
+			best_long = (m, d)
+		if best_long[0] == LONG_MAX and best_short[0] == SHORT_MAX:
+			break
+
+	return best_short, best_long
+
+
+def compress(data, window=512):
+	"""Compress one part into an lzf stream with end marker"""
+
+	n = len(data)
+
+	# Positions of all byte pairs, for match search
+
+	chains = {}
+	matches = []
+	for i in range(n):
+		matches.append(longest_matches(data, i, chains, window))
+		if i + 1 < n:
+			chains.setdefault(data[i] | (data[i + 1] << 8), []).append(i)
+
+	# Optimal parse from the end, cost in bytes with ties broken by
+	# fewer tokens
+
+	INF = (1 << 30, 0)
+	cost = [INF] * (n + 1)
+	step = [None] * (n + 1)
+	cost[n] = (0, 0)
+
+	for i in range(n - 1, -1, -1):
+		best = INF
+		choice = None
+
+		for l in range(1, min(MAX_LITERAL, n - i) + 1):
+			c = (cost[i + l][0] + 1 + l, cost[i + l][1] + 1)
+			if c < best:
+				best, choice = c, ('L', l, 0)
+
+		(ms, ds), (ml, dl) = matches[i]
+		for l in range(SHORT_MIN, ms + 1):
+			c = (cost[i + l][0] + 2, cost[i + l][1] + 1)
+			if c < best:
+				best, choice = c, ('S', l, ds)
+		for l in range(LONG_MIN, ml + 1):
+			c = (cost[i + l][0] + 3, cost[i + l][1] + 1)
+			if c < best:
+				best, choice = c, ('M', l, dl)
+
+		cost[i] = best
+		step[i] = choice
+
+	# Emit tokens
+
+	out = bytearray()
+	tokens = []
+	i = 0
+	while i < n:
+		kind, l, d = step[i]
+		tokens.append((kind, l))
+		if kind == 'L':
+			out.append(l)
+			out += data[i:i + l]
+		elif kind == 'S':
+			out.append(0x80 | (l - SHORT_MIN))
+			out.append(d - 1)
+		else:
+			out.append(0xc0 | (l - LONG_MIN))
+			out += ((-d) & 0xffff).to_bytes(2, 'little')
+		i += l
+	out.append(0)
+
+	return bytes(out), tokens
+
+
+def expand(stream, pos=0):
+	"""Expand one lzf stream, returns data and position behind end marker"""
+
+	out = bytearray()
+	while True:
+		t = stream[pos]
+		if t == 0:
+			return bytes(out), pos + 1
+		elif t < 0x80:
+			out += stream[pos + 1:pos + 1 + t]
+			pos += 1 + t
+		else:
+			if t < 0xc0:
+				l = (t & 0x3f) + SHORT_MIN
+				d = stream[pos + 1] + 1
+				pos += 2
+			else:
+				l = (t & 0x3f) + LONG_MIN
+				d = 0x10000 - (stream[pos + 1] | (stream[pos + 2] << 8))
+				pos += 3
+			for k in range(l):
+				out.append(out[-d])
+
+
+def cycles(tokens):
+	"""Estimated decode cycles for a token list"""
+
+	c = CYCLES_END
+	for kind, l in tokens:
+		c += {'L': CYCLES_LITERAL, 'S': CYCLES_SHORT, 'M': CYCLES_LONG}[kind]
+		c += CYCLES_BYTE * l
+	return c
+
+
+def load_part(spec):
+	"""Read a part given as file[:offset:size]"""
+
+	parts = spec.rsplit(':', 2)
+	if len(parts) == 3 and parts[1].isdigit() and parts[2].isdigit():
+		name, offset, size = parts[0], int(parts[1]), int(parts[2])
+	else:
+		name, offset, size = spec, 0, None
+
+	with open(name, 'rb') as f:
+		data = f.read()
+	data = data[offset:] if size is None else data[offset:offset + size]
+	return data
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Compress assets into lzf streams')
+	parser.add_argument('output')
+	parser.add_argument('inputs', nargs='+', help='file[:offset:size]')
+	parser.add_argument('--bench', action='store_true', help='print size and decode time')
+	args = parser.parse_args()
+
+	out = bytearray()
+	for spec in args.inputs:
+		data = load_part(spec)
+		stream, tokens = compress(data)
+
+		check, _ = expand(stream)
+		if check != data:
+			sys.exit('lzfpack: verification failed for ' + spec)
+
+		if args.bench:
+			c = cycles(tokens)
+			print('%-40s %6d -> %6d bytes, %7d cycles, %5.1f cycles/byte' %
+				(spec, len(data), len(stream), c, c / max(1, len(data))))
+
+		out += stream
+
+	with open(args.output, 'wb') as f:
+		f.write(out)
+
+
+if __name__ == '__main__':
+	main()
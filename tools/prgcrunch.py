@@ -0,0 +1,343 @@
+#!/usr/bin/env python3
+"""Crunch a PRG into a self extracting PRG with in place decompression.
+
+The program is compressed with the lzf format of lzfpack.py.  The result
+starts with a BASIC line that calls a short stub.  The stub copies the
+decruncher into the cassette buffer, moves the compressed data to the top
+of its final location and expands it into the original load address.  The
+compressed data ends just far enough behind the expanded program that
+the decruncher never overwrites bytes it has not read yet.  After
+expansion, the original program is started at the address of its own
+BASIC SYS line.
+
+  prgcrunch.py [--verify] ballnchain.prg ballnchain-crunched.prg
+
+The report gives sizes, disk blocks, the load time with the stock kernal
+loader and the decrunch time.  The load time is an estimate from a fixed
+throughput, it is not measured, true drive emulation of the built image
+is still needed for a real figure.  The decrunch time is estimated from
+the token counts, with --verify the cycles of the emulated run are
+reported next to it.  With --verify, the
+crunched program is run in the 6502 emulation of sidstream.py and the
+expanded memory is compared with the original.
+"""
+
+import argparse
+import sys
+
+import lzfpack
+from asm6502 import assemble, CYCLES
+
+LOAD = 0x0801
+
+# Zero page used by the decruncher, free while BASIC runs a program
+
+ZP_SP, ZP_DP, ZP_MP, ZP_N = 0xf7, 0xf9, 0xfb, 0xfd
+
+# Decruncher location, the cassette buffer
+
+DECRUNCH = 0x0334
+
+# Highest end address of the compressed data, below the CPU vectors
+
+TOP = 0xfff0
+
+# Assumed stock kernal loader throughput with a 1541, bytes per second,
+# a typical figure, not measured for this image
+
+KERNAL_RATE = 400
+
+def decruncher(entry):
+	"""lzf decoder from ZP_SP to ZP_DP, starts the program when done"""
+
+	return assemble(DECRUNCH, [
+		('loop',),
+		('ldy', 'imm', 0),
+		('lda', 'indy', ZP_SP),
+		('beq', 'rel', 'done'),
+		('bmi', 'rel', 'match'),
+
+		# Literal run
+		('sta', 'zp', ZP_N),
+		('inc', 'zp', ZP_SP),
+		('bne', 'rel', 'lcopy'),
+		('inc', 'zp', ZP_SP + 1),
+		('lcopy',),
+		('lda', 'indy', ZP_SP),
+		('sta', 'indy', ZP_DP),
+		('iny', ''),
+		('cpy', 'zp', ZP_N),
+		('bne', 'rel', 'lcopy'),
+		('tya', ''),
+		('clc', ''),
+		('adc', 'zp', ZP_SP),
+		('sta', 'zp', ZP_SP),
+		('bcc', 'rel', 'lnext'),
+		('inc', 'zp', ZP_SP + 1),
+		('clc', ''),
+		('lnext',),
+		('tya', ''),
+		('adc', 'zp', ZP_DP),
+		('sta', 'zp', ZP_DP),
+		('bcc', 'rel', 'loop'),
+		('inc', 'zp', ZP_DP + 1),
+		('jmp', 'abs', 'loop'),
+
+		('done',),
+		('lda', 'imm', 0x37),
+		('sta', 'zp', 0x01),
+		('cli', ''),
+		('jmp', 'abs', entry),
+
+		# Short match
+		('match',),
+		('cmp', 'imm', 0xc0),
+		('bcs', 'rel', 'mlong'),
+		('and', 'imm', 0x3f),
+		('adc', 'imm', 2),
+		('sta', 'zp', ZP_N),
+		('iny', ''),
+		('lda', 'indy', ZP_SP),
+		('eor', 'imm', 0xff),
+		('clc', ''),
+		('adc', 'zp', ZP_DP),
+		('sta', 'zp', ZP_MP),
+		('lda', 'zp', ZP_DP + 1),
+		('adc', 'imm', 0xff),
+		('sta', 'zp', ZP_MP + 1),
+		('lda', 'imm', 2),
+		('bne', 'rel', 'mskip'),
+
+		# Long match
+		('mlong',),
+		('and', 'imm', 0x3f),
+		('adc', 'imm', 2),
+		('sta', 'zp', ZP_N),
+		('iny', ''),
+		('lda', 'indy', ZP_SP),
+		('clc', ''),
+		('adc', 'zp', ZP_DP),
+		('sta', 'zp', ZP_MP),
+		('iny', ''),
+		('lda', 'indy', ZP_SP),
+		('adc', 'zp', ZP_DP + 1),
+		('sta', 'zp', ZP_MP + 1),
+		('lda', 'imm', 3),
+
+		('mskip',),
+		('clc', ''),
+		('adc', 'zp', ZP_SP),
+		('sta', 'zp', ZP_SP),
+		('bcc', 'rel', 'mcopy0'),
+		('inc', 'zp', ZP_SP + 1),
+		('mcopy0',),
+		('ldy', 'imm', 0),
+		('mcopy',),
+		('lda', 'indy', ZP_MP),
+		('sta', 'indy', ZP_DP),
+		('iny', ''),
+		('cpy', 'zp', ZP_N),
+		('bne', 'rel', 'mcopy'),
+		('tya', ''),
+		('clc', ''),
+		('adc', 'zp', ZP_DP),
+		('sta', 'zp', ZP_DP),
+		('bcc', 'rel', 'mnext'),
+		('inc', 'zp', ZP_DP + 1),
+		('mnext',),
+		('jmp', 'abs', 'loop'),
+	])[0]
+
+
+def stub(org, dsrc, dlen, csrc, base, pages, out):
+	"""Copy decruncher, move compressed data up page by page from the top,
+	then start the decruncher"""
+
+	top = (pages - 1) * 256
+	return assemble(org, [
+		('sei', ''),
+		('lda', 'imm', 0x34),
+		('sta', 'zp', 0x01),
+
+		('ldx', 'imm', 0),
+		('dcopy',),
+		('lda', 'absx', dsrc),
+		('sta', 'absx', DECRUNCH),
+		('inx', ''),
+		('cpx', 'imm', dlen),
+		('bne', 'rel', 'dcopy'),
+
+		('lda', 'imm', (csrc + top) & 0xff),
+		('sta', 'zp', ZP_SP),
+		('lda', 'imm', (csrc + top) >> 8),
+		('sta', 'zp', ZP_SP + 1),
+		('lda', 'imm', (base + top) & 0xff),
+		('sta', 'zp', ZP_DP),
+		('lda', 'imm', (base + top) >> 8),
+		('sta', 'zp', ZP_DP + 1),
+
+		('ldx', 'imm', pages),
+		('mpage',),
+		('ldy', 'imm', 0xff),
+		('mbyte',),
+		('lda', 'indy', ZP_SP),
+		('sta', 'indy', ZP_DP),
+		('dey', ''),
+		('cpy', 'imm', 0xff),
+		('bne', 'rel', 'mbyte'),
+		('dec', 'zp', ZP_SP + 1),
+		('dec', 'zp', ZP_DP + 1),
+		('dex', ''),
+		('bne', 'rel', 'mpage'),
+
+		('lda', 'imm', base & 0xff),
+		('sta', 'zp', ZP_SP),
+		('lda', 'imm', base >> 8),
+		('sta', 'zp', ZP_SP + 1),
+		('lda', 'imm', out & 0xff),
+		('sta', 'zp', ZP_DP),
+		('lda', 'imm', out >> 8),
+		('sta', 'zp', ZP_DP + 1),
+		('jmp', 'abs', DECRUNCH),
+	])[0]
+
+
+def basic_sys(prg):
+	"""Address of the SYS call in the first BASIC line of a PRG"""
+
+	text = prg[6:prg.index(0, 6)]
+	if not text or text[0] != 0x9e:
+		raise ValueError('program does not start with a SYS line')
+	return int(text[1:].decode('ascii').strip())
+
+
+def margin(tokens, stream, size):
+	"""Distance the compressed data must end behind the expanded data, so
+	that the output of a token never reaches the next unread byte"""
+
+	o = c = 0
+	worst = 0
+	for kind, l in tokens:
+		o += l
+		c += 1 + l if kind == 'L' else 2 if kind == 'S' else 3
+		worst = max(worst, o - c)
+	return worst + len(stream) - size
+
+
+def crunch(prg):
+	"""Crunch a PRG loading at LOAD, returns the crunched PRG and statistics"""
+
+	load = prg[0] | (prg[1] << 8)
+	if load != LOAD:
+		raise ValueError('program must load at %04x' % LOAD)
+
+	data = prg[2:]
+	entry = basic_sys(prg)
+	stream, tokens = lzfpack.compress(data)
+
+	# Compressed data placed to end behind the expanded program
+
+	end = LOAD + len(data) + max(0, margin(tokens, stream, len(data)))
+	base = end - len(stream)
+	if end > TOP:
+		raise ValueError('expanded program too large')
+
+	dec = decruncher(entry)
+
+	# BASIC line 10 SYS to the stub directly behind it
+
+	line = bytes([0x9e]) + b'2061' + bytes([0])
+	basic = (LOAD + 2 + 2 + len(line)).to_bytes(2, 'little') + (10).to_bytes(2, 'little') + line + bytes([0, 0])
+	org = LOAD + len(basic)
+
+	# Stub size does not depend on its operands
+
+	size = len(stub(org, 0, len(dec), 0, 0, 1, 0))
+	dsrc = org + size
+	csrc = dsrc + len(dec)
+	pages = (len(stream) + 255) // 256
+	if base < csrc or base + pages * 256 > TOP:
+		raise ValueError('no room to move compressed data')
+
+	code = stub(org, dsrc, len(dec), csrc, base, pages, LOAD)
+	out = LOAD.to_bytes(2, 'little') + basic + code + dec + stream
+
+	stats = {
+		'size': len(prg), 'crunched': len(out),
+		'entry': entry, 'base': base, 'end': end,
+		'cycles': lzfpack.cycles(tokens) + pages * 256 * 14,
+	}
+	return out, stats
+
+
+def verify(prg, out):
+	"""Run the crunched program and compare memory at the original entry,
+	returns the result and the cycles of the run, base timings plus taken
+	branches"""
+
+	from sidstream import CPU6502
+
+	mem = bytearray([0x55]) * 0x10000
+	load = out[0] | (out[1] << 8)
+	mem[load:load + len(out) - 2] = out[2:]
+
+	cpu = CPU6502(mem, lambda a, v: None)
+	cpu.pc = 2061
+	entry = basic_sys(prg)
+	steps = 0
+	cycles = 0
+	while steps == 0 or cpu.pc != entry:
+		pc = cpu.pc
+		op = mem[pc]
+		try:
+			cpu.step()
+		except RuntimeError:
+			return False, cycles
+		cycles += CYCLES.get(op, 4)
+		if op & 0x1f == 0x10 and cpu.pc != ((pc + 2) & 0xffff):
+			cycles += 1
+		steps += 1
+		if steps > 20000000:
+			return False, cycles
+
+	data = prg[2:]
+	return bytes(mem[LOAD:LOAD + len(data)]) == data and mem[0x01] == 0x37, cycles
+
+
+def blocks(n):
+	return (n + 253) // 254
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Crunch a PRG with in place decompression')
+	parser.add_argument('input')
+	parser.add_argument('output')
+	parser.add_argument('--verify', action='store_true', help='expand in the 6502 emulation and compare')
+	args = parser.parse_args()
+
+	with open(args.input, 'rb') as f:
+		prg = f.read()
+
+	out, stats = crunch(prg)
+
+	run = None
+	if args.verify:
+		ok, run = verify(prg, out)
+		if not ok:
+			sys.exit('prgcrunch: verification failed')
+
+	with open(args.output, 'wb') as f:
+		f.write(out)
+
+	print('%-12s %6d bytes, %3d blocks, %5.1f s kernal load (estimate at %d B/s, not measured)' %
+		('original', stats['size'], blocks(stats['size']), stats['size'] / KERNAL_RATE, KERNAL_RATE))
+	print('%-12s %6d bytes, %3d blocks, %5.1f s kernal load (estimate at %d B/s, not measured)' %
+		('crunched', stats['crunched'], blocks(stats['crunched']), stats['crunched'] / KERNAL_RATE, KERNAL_RATE))
+	print('%-12s %4.2f s estimated%s' %
+		('decrunch', stats['cycles'] / 985248,
+		', %4.2f s in the 6502 emulation' % (run / 985248) if run is not None else ''))
+	print('entry %04x, compressed data %04x-%04x' % (stats['entry'], stats['base'], stats['end']))
+
+
+if __name__ == '__main__':
+	main()
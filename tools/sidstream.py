@@ -0,0 +1,710 @@
+#!/usr/bin/env python3
+"""Convert a sub tune of a PSID file into a SID register write stream.
+
+The replay routine of the tune is run in a small 6502 emulation, and the
+SID register writes of each play call are recorded.  Writes that do not
+change a register are dropped, ticks without writes are run length encoded,
+and the stream ends with a jump back to the first repeated player state,
+so the tune loops like the original.
+
+The writes are split into four channels, one for each voice and one for
+the filter and volume registers, each channel is compressed on its own.
+Repeated sequences of ticks are replaced by references to the earlier
+occurrence, which may contain references themselves.
+
+Stream format, all values are bytes, offsets are little endian and
+relative to the start of the file:
+
+  header            four times two offsets, start of the channel stream
+                    and loop tick of the channel stream
+  tick              one of
+    0x01..0x7f n    n register writes follow, each as register index
+                    (0..24) and value, in the order the player wrote them
+    0x80..0xfd      an empty tick, followed by (n & 0x7f) more empty ticks
+    0xfe t o        replay t ticks starting at offset o, then continue
+    0xff            jump to the loop tick
+
+The first tick holds the writes of the init call, it is played when the
+tune is started.
+
+The game no longer plays register streams, none of the sub tunes fits
+beside the game.  The converter stays to report stream sizes, and the
+6502 emulation and --profile are used by the other tools.
+
+Usage:
+
+  sidstream.py GameScene.sid 3 "GameScene - Stream 3.bin"
+  sidstream.py --profile 3000 GameScene.sid 3
+
+With --profile, no stream is written.  The replay routine is called for
+the given number of ticks, and the cycles per play call are reported.
+The count uses base instruction timings plus taken branches, without
+page crossing penalties and without the interrupt entry and exit.
+"""
+
+import argparse
+import hashlib
+import sys
+
+from asm6502 import CYCLES
+
+
+class CPU6502:
+	"""Documented 6502 instruction set, enough to run music replay code"""
+
+	def __init__(self, mem, on_write):
+		self.mem = mem
+		self.on_write = on_write
+		self.a = self.x = self.y = 0
+		self.sp = 0xff
+		self.pc = 0
+		self.c = self.z = self.i = self.d = self.v = self.n = 0
+
+	# Memory access
+
+	def rd(self, a):
+		return self.mem[a & 0xffff]
+
+	def wr(self, a, v):
+		a &= 0xffff
+		self.mem[a] = v & 0xff
+		self.on_write(a, v & 0xff)
+
+	def rd16(self, a):
+		return self.rd(a) | (self.rd(a + 1) << 8)
+
+	def rd16zp(self, a):
+		return self.rd(a & 0xff) | (self.rd((a + 1) & 0xff) << 8)
+
+	def fetch(self):
+		v = self.rd(self.pc)
+		self.pc = (self.pc + 1) & 0xffff
+		return v
+
+	def fetch16(self):
+		v = self.fetch()
+		return v | (self.fetch() << 8)
+
+	def push(self, v):
+		self.mem[0x100 + self.sp] = v & 0xff
+		self.sp = (self.sp - 1) & 0xff
+
+	def pull(self):
+		self.sp = (self.sp + 1) & 0xff
+		return self.mem[0x100 + self.sp]
+
+	# Flags
+
+	def nz(self, v):
+		v &= 0xff
+		self.z = int(v == 0)
+		self.n = v >> 7
+		return v
+
+	def getp(self):
+		return (self.n << 7) | (self.v << 6) | 0x30 | (self.d << 3) | (self.i << 2) | (self.z << 1) | self.c
+
+	def setp(self, p):
+		self.n = (p >> 7) & 1
+		self.v = (p >> 6) & 1
+		self.d = (p >> 3) & 1
+		self.i = (p >> 2) & 1
+		self.z = (p >> 1) & 1
+		self.c = p & 1
+
+	# Addressing modes, return effective address
+
+	def am_zp(self):
+		return self.fetch()
+
+	def am_zpx(self):
+		return (self.fetch() + self.x) & 0xff
+
+	def am_zpy(self):
+		return (self.fetch() + self.y) & 0xff
+
+	def am_abs(self):
+		return self.fetch16()
+
+	def am_absx(self):
+		return (self.fetch16() + self.x) & 0xffff
+
+	def am_absy(self):
+		return (self.fetch16() + self.y) & 0xffff
+
+	def am_indx(self):
+		return self.rd16zp(self.fetch() + self.x)
+
+	def am_indy(self):
+		return (self.rd16zp(self.fetch()) + self.y) & 0xffff
+
+	# ALU
+
+	def adc(self, m):
+		if self.d:
+			lo = (self.a & 0x0f) + (m & 0x0f) + self.c
+			hi = (self.a >> 4) + (m >> 4)
+			if lo > 9:
+				lo += 6
+				hi += 1
+			r = self.a + m + self.c
+			self.z = int((r & 0xff) == 0)
+			self.n = (hi >> 3) & 1
+			self.v = int(((self.a ^ (hi << 4)) & 0x80) != 0 and ((self.a ^ m) & 0x80) == 0)
+			if hi > 9:
+				hi += 6
+			self.c = int(hi > 15)
+			self.a = ((hi << 4) | (lo & 0x0f)) & 0xff
+		else:
+			r = self.a + m + self.c
+			self.v = int(((self.a ^ r) & (m ^ r) & 0x80) != 0)
+			self.c = int(r > 0xff)
+			self.a = self.nz(r)
+
+	def sbc(self, m):
+		if self.d:
+			r = self.a - m - (1 - self.c)
+			lo = (self.a & 0x0f) - (m & 0x0f) - (1 - self.c)
+			hi = (self.a >> 4) - (m >> 4)
+			if lo < 0:
+				lo -= 6
+				hi -= 1
+			if hi < 0:
+				hi -= 6
+			self.v = int(((self.a ^ r) & (self.a ^ m) & 0x80) != 0)
+			self.c = int(r >= 0)
+			self.nz(r)
+			self.a = ((hi << 4) | (lo & 0x0f)) & 0xff
+		else:
+			r = self.a - m - (1 - self.c)
+			self.v = int(((self.a ^ r) & (self.a ^ m) & 0x80) != 0)
+			self.c = int(r >= 0)
+			self.a = self.nz(r)
+
+	def cmp(self, r, m):
+		t = r - m
+		self.c = int(t >= 0)
+		self.nz(t)
+
+	def branch(self, cond):
+		o = self.fetch()
+		if cond:
+			self.pc = (self.pc + (o - 256 if o & 0x80 else o)) & 0xffff
+
+	# Read modify write
+
+	def rmw(self, addr, op):
+		if addr is None:
+			self.a = op(self.a)
+		else:
+			self.wr(addr, op(self.rd(addr)))
+
+	def asl(self, v):
+		self.c = v >> 7
+		return self.nz(v << 1)
+
+	def lsr(self, v):
+		self.c = v & 1
+		return self.nz(v >> 1)
+
+	def rol(self, v):
+		r = (v << 1) | self.c
+		self.c = v >> 7
+		return self.nz(r)
+
+	def ror(self, v):
+		r = (v >> 1) | (self.c << 7)
+		self.c = v & 1
+		return self.nz(r)
+
+	def step(self):
+		op = self.fetch()
+
+		# Regular opcodes by table lookup of operation and addressing mode
+		if op in ALU_OPS:
+			name, mode = ALU_OPS[op]
+			if mode == 'imm':
+				m = self.fetch()
+			else:
+				m = self.rd(getattr(self, 'am_' + mode)())
+			if name == 'ora':
+				self.a = self.nz(self.a | m)
+			elif name == 'and':
+				self.a = self.nz(self.a & m)
+			elif name == 'eor':
+				self.a = self.nz(self.a ^ m)
+			elif name == 'adc':
+				self.adc(m)
+			elif name == 'sbc':
+				self.sbc(m)
+			elif name == 'cmp':
+				self.cmp(self.a, m)
+			elif name == 'cpx':
+				self.cmp(self.x, m)
+			elif name == 'cpy':
+				self.cmp(self.y, m)
+			elif name == 'lda':
+				self.a = self.nz(m)
+			elif name == 'ldx':
+				self.x = self.nz(m)
+			elif name == 'ldy':
+				self.y = self.nz(m)
+			elif name == 'bit':
+				self.z = int((self.a & m) == 0)
+				self.n = (m >> 7) & 1
+				self.v = (m >> 6) & 1
+			return
+
+		if op in STORE_OPS:
+			name, mode = STORE_OPS[op]
+			addr = getattr(self, 'am_' + mode)()
+			self.wr(addr, {'sta': self.a, 'stx': self.x, 'sty': self.y}[name])
+			return
+
+		if op in RMW_OPS:
+			name, mode = RMW_OPS[op]
+			addr = None if mode == 'acc' else getattr(self, 'am_' + mode)()
+			if name == 'inc':
+				self.rmw(addr, lambda v: self.nz(v + 1))
+			elif name == 'dec':
+				self.rmw(addr, lambda v: self.nz(v - 1))
+			else:
+				self.rmw(addr, getattr(self, name))
+			return
+
+		if op == 0x4c:
+			self.pc = self.fetch16()
+		elif op == 0x6c:
+			a = self.fetch16()
+			self.pc = self.rd(a) | (self.rd((a & 0xff00) | ((a + 1) & 0xff)) << 8)
+		elif op == 0x20:
+			t = self.fetch16()
+			r = (self.pc - 1) & 0xffff
+			self.push(r >> 8)
+			self.push(r)
+			self.pc = t
+		elif op == 0x60:
+			lo = self.pull()
+			self.pc = ((self.pull() << 8) | lo) + 1 & 0xffff
+		elif op == 0x40:
+			self.setp(self.pull())
+			lo = self.pull()
+			self.pc = (self.pull() << 8) | lo
+		elif op == 0x10: self.branch(not self.n)
+		elif op == 0x30: self.branch(self.n)
+		elif op == 0x50: self.branch(not self.v)
+		elif op == 0x70: self.branch(self.v)
+		elif op == 0x90: self.branch(not self.c)
+		elif op == 0xb0: self.branch(self.c)
+		elif op == 0xd0: self.branch(not self.z)
+		elif op == 0xf0: self.branch(self.z)
+		elif op == 0x18: self.c = 0
+		elif op == 0x38: self.c = 1
+		elif op == 0x58: self.i = 0
+		elif op == 0x78: self.i = 1
+		elif op == 0xb8: self.v = 0
+		elif op == 0xd8: self.d = 0
+		elif op == 0xf8: self.d = 1
+		elif op == 0xaa: self.x = self.nz(self.a)
+		elif op == 0x8a: self.a = self.nz(self.x)
+		elif op == 0xa8: self.y = self.nz(self.a)
+		elif op == 0x98: self.a = self.nz(self.y)
+		elif op == 0xba: self.x = self.nz(self.sp)
+		elif op == 0x9a: self.sp = self.x
+		elif op == 0xe8: self.x = self.nz(self.x + 1)
+		elif op == 0xca: self.x = self.nz(self.x - 1)
+		elif op == 0xc8: self.y = self.nz(self.y + 1)
+		elif op == 0x88: self.y = self.nz(self.y - 1)
+		elif op == 0x48: self.push(self.a)
+		elif op == 0x68: self.a = self.nz(self.pull())
+		elif op == 0x08: self.push(self.getp())
+		elif op == 0x28: self.setp(self.pull())
+		elif op == 0xea: pass
+		else:
+			raise RuntimeError('unsupported opcode %02x at %04x' % (op, (self.pc - 1) & 0xffff))
+
+
+def _ops(table):
+	ops = {}
+	for name, modes in table.items():
+		for mode, code in modes.items():
+			ops[code] = (name, mode)
+	return ops
+
+
+ALU_OPS = _ops({
+	'ora': {'imm': 0x09, 'zp': 0x05, 'zpx': 0x15, 'abs': 0x0d, 'absx': 0x1d, 'absy': 0x19, 'indx': 0x01, 'indy': 0x11},
+	'and': {'imm': 0x29, 'zp': 0x25, 'zpx': 0x35, 'abs': 0x2d, 'absx': 0x3d, 'absy': 0x39, 'indx': 0x21, 'indy': 0x31},
+	'eor': {'imm': 0x49, 'zp': 0x45, 'zpx': 0x55, 'abs': 0x4d, 'absx': 0x5d, 'absy': 0x59, 'indx': 0x41, 'indy': 0x51},
+	'adc': {'imm': 0x69, 'zp': 0x65, 'zpx': 0x75, 'abs': 0x6d, 'absx': 0x7d, 'absy': 0x79, 'indx': 0x61, 'indy': 0x71},
+	'sbc': {'imm': 0xe9, 'zp': 0xe5, 'zpx': 0xf5, 'abs': 0xed, 'absx': 0xfd, 'absy': 0xf9, 'indx': 0xe1, 'indy': 0xf1},
+	'cmp': {'imm': 0xc9, 'zp': 0xc5, 'zpx': 0xd5, 'abs': 0xcd, 'absx': 0xdd, 'absy': 0xd9, 'indx': 0xc1, 'indy': 0xd1},
+	'lda': {'imm': 0xa9, 'zp': 0xa5, 'zpx': 0xb5, 'abs': 0xad, 'absx': 0xbd, 'absy': 0xb9, 'indx': 0xa1, 'indy': 0xb1},
+	'cpx': {'imm': 0xe0, 'zp': 0xe4, 'abs': 0xec},
+	'cpy': {'imm': 0xc0, 'zp': 0xc4, 'abs': 0xcc},
+	'ldx': {'imm': 0xa2, 'zp': 0xa6, 'zpy': 0xb6, 'abs': 0xae, 'absy': 0xbe},
+	'ldy': {'imm': 0xa0, 'zp': 0xa4, 'zpx': 0xb4, 'abs': 0xac, 'absx': 0xbc},
+	'bit': {'zp': 0x24, 'abs': 0x2c},
+})
+
+STORE_OPS = _ops({
+	'sta': {'zp': 0x85, 'zpx': 0x95, 'abs': 0x8d, 'absx': 0x9d, 'absy': 0x99, 'indx': 0x81, 'indy': 0x91},
+	'stx': {'zp': 0x86, 'zpy': 0x96, 'abs': 0x8e},
+	'sty': {'zp': 0x84, 'zpx': 0x94, 'abs': 0x8c},
+})
+
+RMW_OPS = _ops({
+	'asl': {'acc': 0x0a, 'zp': 0x06, 'zpx': 0x16, 'abs': 0x0e, 'absx': 0x1e},
+	'lsr': {'acc': 0x4a, 'zp': 0x46, 'zpx': 0x56, 'abs': 0x4e, 'absx': 0x5e},
+	'rol': {'acc': 0x2a, 'zp': 0x26, 'zpx': 0x36, 'abs': 0x2e, 'absx': 0x3e},
+	'ror': {'acc': 0x6a, 'zp': 0x66, 'zpx': 0x76, 'abs': 0x6e, 'absx': 0x7e},
+	'inc': {'zp': 0xe6, 'zpx': 0xf6, 'abs': 0xee, 'absx': 0xfe},
+	'dec': {'zp': 0xc6, 'zpx': 0xd6, 'abs': 0xce, 'absx': 0xde},
+})
+
+
+# Limits of the stream encoding and of the replay code
+
+MAX_EMPTY = 126			# Ticks in one run of empty ticks, 0x80..0xfd
+MAX_REF_TICKS = 255		# Ticks replayed by one reference
+MAX_DEPTH = 4			# Nesting of references, size of the replay stack
+MAX_CANDIDATES = 64		# Earlier units checked for a match
+REF_SIZE = 4			# Bytes of a reference
+
+# Registers of the four channels, three voices and filter with volume
+
+CHANNELS = [range(0, 7), range(7, 14), range(14, 21), range(21, 25)]
+CHANNEL_HEADER = 4
+
+
+class SIDRecorder:
+	"""Run the player of a PSID file and record SID writes per call"""
+
+	RETURN = 0xfff0
+
+	def __init__(self, data):
+		if data[0:4] not in (b'PSID', b'RSID'):
+			raise ValueError('not a PSID file')
+
+		offset = (data[6] << 8) | data[7]
+		load = (data[8] << 8) | data[9]
+		self.init = (data[10] << 8) | data[11]
+		self.play = (data[12] << 8) | data[13]
+		self.songs = (data[14] << 8) | data[15]
+
+		body = data[offset:]
+		if load == 0:
+			load = body[0] | (body[1] << 8)
+			body = body[2:]
+
+		self.mem = bytearray(0x10000)
+		self.mem[load:load + len(body)] = body
+		self.region = (load, load + len(body))
+
+		self.writes = []
+		self.cycles = 0
+		self.cpu = CPU6502(self.mem, self.write)
+
+	def write(self, addr, value):
+		if 0xd400 <= addr <= 0xd418:
+			self.writes.append((addr - 0xd400, value))
+
+	def call(self, addr, a=0, limit=1000000):
+		cpu = self.cpu
+		cpu.a = a
+		cpu.x = cpu.y = 0
+		cpu.sp = 0xff
+		cpu.push((self.RETURN - 1) >> 8)
+		cpu.push(self.RETURN - 1)
+		cpu.pc = addr
+		self.writes = []
+		self.cycles = 6
+		for _ in range(limit):
+			if cpu.pc == self.RETURN:
+				return self.writes
+			pc = cpu.pc
+			op = self.mem[pc]
+			cpu.step()
+			self.cycles += CYCLES.get(op, 4)
+			if op & 0x1f == 0x10 and cpu.pc != ((pc + 2) & 0xffff):
+				self.cycles += 1
+		raise RuntimeError('player call at %04x does not return' % addr)
+
+	def state(self):
+		lo, hi = self.region
+		return hashlib.sha1(bytes(self.mem[0:0x100]) + bytes(self.mem[lo:hi]) + bytes(self.mem[0xd400:0xd419])).digest()
+
+
+def encode_tick(writes, regs):
+	"""Encode the writes of one tick, dropping writes that keep a register value"""
+
+	pairs = []
+	for reg, value in writes:
+		if regs[reg] != value:
+			regs[reg] = value
+			pairs.append((reg, value))
+
+	return pairs
+
+
+def convert(data, tune, init_addr, play_addr, max_ticks):
+	rec = SIDRecorder(data)
+	init = init_addr if init_addr is not None else rec.init
+	play = play_addr if play_addr is not None else rec.play
+
+	# Register contents are unknown at start, so all writes of init are kept
+	regs = [None] * 25
+	ticks = [encode_tick(rec.call(init, tune), regs)]
+
+	seen = {rec.state(): 1}
+	loop = None
+
+	for t in range(max_ticks):
+		ticks.append(encode_tick(rec.call(play), regs))
+		s = rec.state()
+		if s in seen:
+			loop = seen[s]
+			break
+		seen[s] = len(ticks)
+
+	if loop is None:
+		loop = 1
+		print('warning: no loop found in %d ticks, restarting after the last tick' % max_ticks, file=sys.stderr)
+
+	# Split into channels and compress each channel on its own
+	out = bytearray(4 * CHANNEL_HEADER)
+	for c, regs in enumerate(CHANNELS):
+		cticks = [[w for w in tick if w[0] in regs] for tick in ticks]
+		start = len(out)
+		stream, loop_offset = compress(tokenize(cticks, loop), loop, start)
+		out += stream
+
+		if len(out) > 0x10000:
+			raise ValueError('stream of %d bytes after channel %d exceeds 64K' % (len(out), c))
+
+		out[c * CHANNEL_HEADER + 0] = start & 0xff
+		out[c * CHANNEL_HEADER + 1] = start >> 8
+		out[c * CHANNEL_HEADER + 2] = loop_offset & 0xff
+		out[c * CHANNEL_HEADER + 3] = loop_offset >> 8
+
+	# Replay the stream like the 6502 code and compare, including one pass
+	# through the loop
+	for c, regs in enumerate(CHANNELS):
+		expect = [[w for w in tick if w[0] in regs] for tick in ticks]
+		expect += expect[loop:]
+		if replay(out, c, len(expect)) != expect:
+			raise RuntimeError('stream verification failed for channel %d' % c)
+
+	return out, len(ticks), loop
+
+
+def profile(data, tune, init_addr, play_addr, count):
+	"""Cycles of count play calls after init, returns min, average and max"""
+
+	rec = SIDRecorder(data)
+	rec.call(init_addr if init_addr is not None else rec.init, tune)
+	play = play_addr if play_addr is not None else rec.play
+
+	cycles = []
+	for _ in range(count):
+		rec.call(play)
+		cycles.append(rec.cycles)
+
+	return min(cycles), sum(cycles) / len(cycles), max(cycles)
+
+
+def replay(data, channel, count):
+	"""Decode count ticks of one channel of a stream"""
+
+	sp = data[channel * CHANNEL_HEADER] | (data[channel * CHANNEL_HEADER + 1] << 8)
+	loop = data[channel * CHANNEL_HEADER + 2] | (data[channel * CHANNEL_HEADER + 3] << 8)
+	skip = 0
+	stack = []
+	ticks = []
+
+	for _ in range(count):
+		if skip:
+			skip -= 1
+			ticks.append([])
+		else:
+			while True:
+				c = data[sp]
+				sp += 1
+				if c < 0x80:
+					ticks.append([(data[sp + 2 * i], data[sp + 2 * i + 1]) for i in range(c)])
+					sp += 2 * c
+					break
+				elif c < 0xfe:
+					skip = c & 0x7f
+					ticks.append([])
+					break
+				elif c == 0xfe:
+					if len(stack) == MAX_DEPTH:
+						raise RuntimeError('reference nesting too deep')
+					stack.append([sp + 3, data[sp]])
+					sp = data[sp + 1] | (data[sp + 2] << 8)
+				else:
+					sp = loop
+
+		# Count tick in all active references, return from completed ones
+		for frame in stack:
+			frame[1] -= 1
+		while stack and stack[-1][1] == 0:
+			sp = stack.pop()[0]
+
+	return ticks
+
+
+def tokenize(ticks, loop):
+	"""Split ticks into tokens, a tick with writes or a run of empty ticks,
+	runs of empty ticks are split at the loop tick"""
+
+	tokens = []
+	i = 0
+	while i < len(ticks):
+		if ticks[i]:
+			if len(ticks[i]) > 127:
+				raise ValueError('too many register writes in tick %d' % i)
+			tokens.append((tuple(ticks[i]), 1))
+			i += 1
+		else:
+			n = 1
+			while i + n < len(ticks) and n < MAX_EMPTY and not ticks[i + n] and i + n != loop:
+				n += 1
+			tokens.append(((), n))
+			i += n
+	return tokens
+
+
+def token_bytes(token):
+	pairs, n = token
+	if pairs:
+		out = bytearray([len(pairs)])
+		for reg, value in pairs:
+			out.append(reg)
+			out.append(value)
+		return out
+	else:
+		return bytearray([0x80 | (n - 1)])
+
+
+def compress(tokens, loop, base):
+	"""Replace repeated sequences of tokens with references to earlier
+	units of the stream, a reference replays a number of ticks starting
+	at a stream offset and may itself contain references"""
+
+	# Intern tokens for fast compare
+	ids = {}
+	tid = [ids.setdefault(t, len(ids)) for t in tokens]
+	size = [len(token_bytes(t)) for t in tokens]
+
+	# Token index of the loop tick
+	loop_token = 0
+	tick = 0
+	while tick < loop:
+		tick += tokens[loop_token][1]
+		loop_token += 1
+
+	# Emitted units: first token, token count, tick count, depth, offset
+	units = []
+	cands = {}
+	offset = base
+	i = 0
+	while i < len(tokens):
+		best = None
+		best_gain = REF_SIZE
+		for u in reversed(cands.get(tid[i], [])[-MAX_CANDIDATES:]):
+			n = 0
+			ticks = 0
+			depth = 0
+			gain = 0
+			k = u
+			while k < len(units):
+				first, count, uticks, udepth = units[k][:4]
+				j = i + n
+				if j + count > len(tokens) or ticks + uticks > MAX_REF_TICKS:
+					break
+
+				# The loop tick has to stay the start of a unit
+				if i < loop_token < j + count:
+					break
+				if tid[j:j + count] != tid[first:first + count]:
+					break
+				n += count
+				ticks += uticks
+				depth = max(depth, udepth)
+				gain += sum(size[first:first + count])
+				k += 1
+			if n > 0 and gain > best_gain and depth < MAX_DEPTH:
+				best = (u, n, ticks, depth + 1)
+				best_gain = gain
+
+		if best:
+			u, n, ticks, depth = best
+			units.append((i, n, ticks, depth, offset, units[u][4]))
+			offset += REF_SIZE
+		else:
+			units.append((i, 1, tokens[i][1], 0, offset, None))
+			offset += size[i]
+			n = 1
+
+		cands.setdefault(tid[i], []).append(len(units) - 1)
+		i += n
+
+	# Serialize units
+	out = bytearray()
+	loop_offset = None
+	for first, count, ticks, depth, uoffset, target in units:
+		if first == loop_token:
+			loop_offset = base + len(out)
+		if target is None:
+			out += token_bytes(tokens[first])
+		else:
+			out += bytearray([0xfe, ticks, target & 0xff, (target >> 8) & 0xff])
+
+	# A loop tick past the last unit gets an empty tick, the replay would
+	# otherwise spin forever on a jump to the jump
+	if loop_offset is None:
+		loop_offset = base + len(out)
+		out.append(0x80)
+	out.append(0xff)
+
+	if out[loop_offset - base] == 0xff:
+		raise RuntimeError('loop tick at offset %d is the loop jump' % loop_offset)
+
+	return out, loop_offset
+
+
+def main():
+	ap = argparse.ArgumentParser(description='Convert a PSID sub tune into a SID register write stream')
+	ap.add_argument('sid', help='input PSID file')
+	ap.add_argument('tune', type=int, help='zero based sub tune index, passed in the accu to init')
+	ap.add_argument('out', nargs='?', help='output stream file')
+	ap.add_argument('--init', type=lambda s: int(s, 0), help='init address, default from header')
+	ap.add_argument('--play', type=lambda s: int(s, 0), help='play address, default from header')
+	ap.add_argument('--max-ticks', type=int, default=60000, help='maximum number of play calls to search for a loop')
+	ap.add_argument('--profile', type=int, metavar='TICKS', help='report cycles per play call instead of converting')
+	args = ap.parse_args()
+
+	with open(args.sid, 'rb') as f:
+		data = f.read()
+
+	if args.profile:
+		lo, avg, hi = profile(data, args.tune, args.init, args.play, args.profile)
+		print('tune %d: %d play calls, cycles min %d, avg %.0f, max %d, max %.1f raster lines PAL' %
+			(args.tune, args.profile, lo, avg, hi, hi / 63))
+		return
+
+	if args.out is None:
+		ap.error('output stream file required')
+
+	out, ticks, loop = convert(data, args.tune, args.init, args.play, args.max_ticks)
+
+	with open(args.out, 'wb') as f:
+		f.write(out)
+
+	print('tune %d: %d ticks, loop at tick %d, %d bytes' % (args.tune, ticks, loop, len(out)))
+
+
+if __name__ == '__main__':
+	main()